@@ -0,0 +1,123 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+#include <array>
+#include <boost/crc.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// On-disk format of the power event journal, shared by power-control and the
+// journal reader.  The journal is a sequence of fixed-size records appended
+// to journalFile, which is rotated to rotatedJournalFile once full.  Records
+// are only ever added to this format, never changed.
+namespace power_event_journal
+{
+static constexpr const char* journalFile = "events";
+static constexpr const char* rotatedJournalFile = "events.1";
+
+// "PWEJ"
+static constexpr uint32_t recordMagic = 0x4a455750;
+static constexpr uint8_t unknownCode = 0xff;
+
+enum class RecordType : uint8_t
+{
+    // The daemon started, toState is the initial state
+    start,
+    // fromState to toState, code is the event that caused it
+    transition,
+    // code is the chosen restart cause, data is a mask of all the causes
+    restartCause,
+    // Power supply power OK didn't assert in toState
+    psPowerOKFailed,
+    // SIO power good didn't assert in toState
+    systemPowerGoodFailed,
+};
+
+struct Record
+{
+    uint32_t magic;
+    RecordType type;
+    uint8_t fromState;
+    uint8_t toState;
+    uint8_t code;
+    // Wall-clock time, in ms since the epoch
+    uint64_t realtimeMs;
+    // CLOCK_MONOTONIC time, in us
+    uint64_t monotonicUs;
+    uint32_t data;
+    // CRC-32 of all the fields above
+    uint32_t crc;
+};
+static_assert(sizeof(Record) == 32, "journal records must be 32 bytes");
+
+inline uint32_t getRecordCRC(const Record& record)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(&record, offsetof(Record, crc));
+    return crc.checksum();
+}
+
+// Names of the codes stored in the records, indexed by their values.  These
+// are the power-control enumerator names, which it checks entry by entry.
+static constexpr std::array<const char*, 5> recordTypeNames = {
+    "start", "transition", "restartCause", "psPowerOKFailed",
+    "systemPowerGoodFailed"};
+static constexpr std::array<const char*, 11> powerStateNames = {
+    "on",
+    "waitForPSPowerOK",
+    "waitForSIOPowerGood",
+    "failedTransitionToOn",
+    "off",
+    "transitionToOff",
+    "gracefulTransitionToOff",
+    "cycleOff",
+    "transitionToCycleOff",
+    "gracefulTransitionToCycleOff",
+    "checkForWarmReset"};
+static constexpr std::array<const char*, 21> eventNames = {
+    "psPowerOKAssert",
+    "psPowerOKDeAssert",
+    "sioPowerGoodAssert",
+    "sioPowerGoodDeAssert",
+    "sioS5Assert",
+    "sioS5DeAssert",
+    "postCompleteAssert",
+    "postCompleteDeAssert",
+    "powerButtonPressed",
+    "resetButtonPressed",
+    "powerCycleTimerExpired",
+    "psPowerOKWatchdogTimerExpired",
+    "sioPowerGoodWatchdogTimerExpired",
+    "gracefulPowerOffTimerExpired",
+    "powerOnRequest",
+    "powerOffRequest",
+    "powerCycleRequest",
+    "resetRequest",
+    "gracefulPowerOffRequest",
+    "gracefulPowerCycleRequest",
+    "warmResetDetected"};
+static constexpr std::array<const char*, 7> restartCauseNames = {
+    "command",       "resetButton",        "powerButton", "watchdog",
+    "powerPolicyOn", "powerPolicyRestore", "softReset"};
+
+template <size_t N>
+inline const char* getName(const std::array<const char*, N>& names,
+                           const size_t value)
+{
+    return value < names.size() ? names[value] : "unknown";
+}
+} // namespace power_event_journal
@@ -14,19 +14,41 @@
 // limitations under the License.
 */
 #include "i2c.hpp"
-
-#include <sys/sysinfo.h>
+#include "power_event_journal.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <systemd/sd-bus.h>
 #include <systemd/sd-journal.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/spawn.hpp>
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
+#include <boost/crc.hpp>
+#include <charconv>
+#include <cinttypes>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <gpiod.hpp>
 #include <iostream>
+#include <nlohmann/json.hpp>
+#include <optional>
 #include <sdbusplus/asio/object_server.hpp>
+#include <sdbusplus/server/manager.hpp>
+#include <sstream>
 #include <string_view>
+#include <type_traits>
 
 namespace power_control
 {
@@ -41,11 +63,33 @@ static std::shared_ptr<sdbusplus::asio::dbus_interface> osIface;
 static std::shared_ptr<sdbusplus::asio::dbus_interface> idButtonIface;
 static std::shared_ptr<sdbusplus::asio::dbus_interface> nmiOutIface;
 static std::shared_ptr<sdbusplus::asio::dbus_interface> restartCauseIface;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> metricsIface;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> edgeStormIface;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> statusIface;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> transitionIface;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> loggingIface;
+
+static constexpr const char* hostPath = "/xyz/openbmc_project/state/host0";
+static constexpr int hostId = 0;
+static constexpr const char* hostInterface = "xyz.openbmc_project.State.Host";
+static constexpr const char* chassisPath =
+    "/xyz/openbmc_project/state/chassis0";
+static constexpr const char* chassisInterface =
+    "xyz.openbmc_project.State.Chassis";
+static constexpr const char* objectManagerPath = "/xyz/openbmc_project";
+static constexpr const char* powerControlPath =
+    "/xyz/openbmc_project/control/host0/power_control";
 
 static gpiod::line powerButtonMask;
 static gpiod::line resetButtonMask;
 static bool nmiButtonMasked = false;
 
+// Published button, OS and restart cause state, kept for GetPowerStatus
+static boost::container::flat_map<std::string, bool> buttonsPressed;
+static std::string operatingSystemState = "Inactive";
+static std::string currentRestartCause =
+    "xyz.openbmc_project.State.Host.RestartCause.Unknown";
+
 const static constexpr int powerPulseTimeMs = 200;
 const static constexpr int forceOffPulseTimeMs = 15000;
 const static constexpr int resetPulseTimeMs = 500;
@@ -59,10 +103,29 @@ const static constexpr int powerOffSaveTimeMs = 7000;
 
 const static std::filesystem::path powerControlDir = "/var/lib/power-control";
 const static constexpr std::string_view powerStateFile = "power-state";
+const static constexpr std::string_view pohFile = "poh";
+const static constexpr std::string_view restorePolicyFile = "restore-policy";
 
 static bool nmiEnabled = true;
+
+// GPIO line roles.  Each role defaults to a line of the same name and can be
+// remapped in the power config file.
+static constexpr const char* psPowerOKName = "PS_PWROK";
+static constexpr const char* sioPowerGoodName = "SIO_POWER_GOOD";
+static constexpr const char* sioOnControlName = "SIO_ONCONTROL";
+static constexpr const char* sioS5Name = "SIO_S5";
+static constexpr const char* powerButtonName = "POWER_BUTTON";
+static constexpr const char* resetButtonName = "RESET_BUTTON";
+static constexpr const char* nmiButtonName = "NMI_BUTTON";
+static constexpr const char* idButtonName = "ID_BUTTON";
+static constexpr const char* postCompleteName = "POST_COMPLETE";
+static constexpr const char* powerOutName = "POWER_OUT";
+static constexpr const char* resetOutName = "RESET_OUT";
 static constexpr const char* nmiOutName = "NMI_OUT";
 
+const static std::filesystem::path powerConfigFile =
+    "/usr/share/power-control/power-config.json";
+
 // Timers
 // Time holding GPIOs asserted
 static boost::asio::steady_timer gpioAssertTimer(io);
@@ -104,26 +167,207 @@ static gpiod::line postCompleteLine;
 static boost::asio::posix::stream_descriptor postCompleteEvent(io);
 static gpiod::line nmiOutLine;
 
-static constexpr uint8_t beepPowerFail = 8;
+// Logging.  Messages at or below the build's POWER_CONTROL_LOG_LEVEL are
+// compiled in, and those at or below their subsystem's runtime level are
+// formatted into fixed-size records in a ring, so a filtered message costs a
+// single comparison.  The ring is written to the journal with
+// sd_journal_sendv from a handler posted after the current one, so the
+// handler that logs isn't held up.  The send still runs on the io thread and
+// can block while journald is busy, so each flush writes at most
+// maxLogFlushRecords records before letting other handlers run.  Messages
+// that find the ring full are dropped and counted.
+#ifndef POWER_CONTROL_LOG_LEVEL
+#define POWER_CONTROL_LOG_LEVEL LOG_DEBUG
+#endif
+enum class LogSubsystem
+{
+    stateMachine,
+    gpio,
+    timers,
+    dbus,
+    i2c,
+};
+static constexpr std::array<const char*, 5> logSubsystemNames = {
+    "StateMachine", "GPIO", "Timers", "DBus", "I2C"};
+// Indexed by syslog priority
+static constexpr std::array<const char*, 8> logLevelNames = {
+    "Emergency", "Alert", "Critical", "Error",
+    "Warning",   "Notice", "Info",    "Debug"};
+static std::array<int, logSubsystemNames.size()> logLevels = {
+    LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO};
+const static constexpr std::string_view logLevelsFile = "log-levels";
+static constexpr size_t logRecordSize = 376;
+static constexpr size_t maxLogFields = 8;
+static constexpr size_t logRingSize = 256;
+static constexpr size_t maxLogFlushRecords = 16;
+static constexpr std::string_view logMessageField = "MESSAGE=";
+
+// Starts a structured journal field; the arguments after it form its value
+struct LogField
+{
+    std::string_view name;
+};
 
-static void beep(const uint8_t& beepPriority)
+struct LogRecord
+{
+    int priority;
+    size_t fieldCount;
+    // End of each field in data, which holds the fields as NAME=value
+    std::array<size_t, maxLogFields> fieldEnds;
+    size_t length;
+    std::array<char, logRecordSize> data;
+    // Set while the value of a field that did not fit is being skipped
+    bool dropping;
+    // Part of the message did not fit
+    bool truncated;
+};
+static std::array<LogRecord, logRingSize> logRing;
+static uint64_t logHead = 0;
+static uint64_t logTail = 0;
+static bool logFlushPosted = false;
+static uint64_t droppedLogMessages = 0;
+static uint64_t truncatedLogMessages = 0;
+
+static void appendLog(LogRecord& record, const std::string_view text)
+{
+    if (record.dropping)
+    {
+        return;
+    }
+    size_t length = std::min(text.size(), logRecordSize - record.length);
+    if (length < text.size())
+    {
+        record.truncated = true;
+    }
+    std::memcpy(record.data.data() + record.length, text.data(), length);
+    record.length += length;
+}
+
+template <typename T>
+static std::enable_if_t<std::is_integral_v<T>> appendLog(LogRecord& record,
+                                                        const T value)
 {
-    std::cerr << "Beep with priority: " << (unsigned)beepPriority << "\n";
+    std::array<char, 24> buffer;
+    auto result =
+        std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    appendLog(record,
+              std::string_view(buffer.data(), result.ptr - buffer.data()));
+}
 
-    conn->async_method_call(
-        [](boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "beep returned error with "
-                             "async_method_call (ec = "
-                          << ec << ")\n";
-                return;
-            }
-        },
-        "xyz.openbmc_project.BeepCode", "/xyz/openbmc_project/BeepCode",
-        "xyz.openbmc_project.BeepCode", "Beep", uint8_t(beepPriority));
+// Error codes are formatted only for messages that are kept
+static void appendLog(LogRecord& record, const boost::system::error_code& ec)
+{
+    appendLog(record, ec.message());
+}
+
+static void appendLog(LogRecord& record, const LogField field)
+{
+    // Ends the current field.  Fields that do not fit are dropped along with
+    // their value.
+    if (record.fieldCount + 1 >= maxLogFields ||
+        record.length + field.name.size() + 1 > logRecordSize)
+    {
+        record.dropping = true;
+        record.truncated = true;
+        return;
+    }
+    record.dropping = false;
+    record.fieldEnds[record.fieldCount++] = record.length;
+    appendLog(record, field.name);
+    appendLog(record, "=");
+}
+
+static void flushLog()
+{
+    for (size_t flushed = 0; logTail != logHead; logTail++, flushed++)
+    {
+        if (flushed == maxLogFlushRecords)
+        {
+            boost::asio::post(io, flushLog);
+            return;
+        }
+        LogRecord& record = logRing[logTail % logRingSize];
+        std::array<iovec, maxLogFields + 1> fields;
+        size_t fieldStart = 0;
+        for (size_t i = 0; i < record.fieldCount; i++)
+        {
+            fields[i] = {record.data.data() + fieldStart,
+                         record.fieldEnds[i] - fieldStart};
+            fieldStart = record.fieldEnds[i];
+        }
+        std::array<char, 16> priority;
+        int priorityLength = std::snprintf(priority.data(), priority.size(),
+                                           "PRIORITY=%d", record.priority);
+        fields[record.fieldCount] = {priority.data(),
+                                     static_cast<size_t>(priorityLength)};
+        sd_journal_sendv(fields.data(), record.fieldCount + 1);
+    }
+    logFlushPosted = false;
+}
+
+// Lets callers skip the work of building arguments for a filtered message
+static inline bool logEnabled(const LogSubsystem subsystem, const int priority)
+{
+    return priority <= POWER_CONTROL_LOG_LEVEL &&
+           priority <= logLevels[static_cast<size_t>(subsystem)];
+}
+
+template <int priority, typename... Args>
+static void logMessage(const LogSubsystem subsystem, const Args&... args)
+{
+    if constexpr (priority <= POWER_CONTROL_LOG_LEVEL)
+    {
+        if (!logEnabled(subsystem, priority))
+        {
+            return;
+        }
+        if (logHead - logTail >= logRingSize)
+        {
+            droppedLogMessages++;
+            return;
+        }
+        LogRecord& record = logRing[logHead % logRingSize];
+        record.priority = priority;
+        record.fieldCount = 0;
+        record.length = 0;
+        record.dropping = false;
+        record.truncated = false;
+        appendLog(record, logMessageField);
+        (appendLog(record, args), ...);
+        if (record.truncated)
+        {
+            truncatedLogMessages++;
+        }
+        record.fieldEnds[record.fieldCount++] = record.length;
+        logHead++;
+        if (!logFlushPosted)
+        {
+            logFlushPosted = true;
+            boost::asio::post(io, flushLog);
+        }
+    }
 }
 
+template <typename... Args>
+static void logError(const LogSubsystem subsystem, const Args&... args)
+{
+    logMessage<LOG_ERR>(subsystem, args...);
+}
+
+template <typename... Args>
+static void logInfo(const LogSubsystem subsystem, const Args&... args)
+{
+    logMessage<LOG_INFO>(subsystem, args...);
+}
+
+template <typename... Args>
+static void logDebug(const LogSubsystem subsystem, const Args&... args)
+{
+    logMessage<LOG_DEBUG>(subsystem, args...);
+}
+
+static constexpr uint8_t beepPowerFail = 8;
+
 enum class PowerState
 {
     on,
@@ -139,7 +383,7 @@ enum class PowerState
     checkForWarmReset,
 };
 static PowerState powerState;
-static std::string getPowerStateName(PowerState state)
+static const char* getPowerStateName(PowerState state)
 {
     switch (state)
     {
@@ -177,13 +421,206 @@ static std::string getPowerStateName(PowerState state)
             return "Check for Warm Reset";
             break;
         default:
-            return "unknown state: " + std::to_string(static_cast<int>(state));
+            return "unknown state";
             break;
     }
 }
-static void logStateTransition(const PowerState state)
+
+// Kernel GPIO line events are timestamped from CLOCK_MONOTONIC, the same clock
+// as std::chrono::steady_clock, so edge times, timer expirations and request
+// times can all be compared directly.  Wall-clock time is only derived when a
+// timestamp is published.
+using EventTime = std::chrono::steady_clock::time_point;
+// Time of the event currently being handled by the state machine
+static EventTime eventTime;
+// Time of the last power state change, and its wall clock time as published
+// in LastStateChangeTime
+static EventTime powerStateChangeTime;
+static uint64_t powerStateChangeRealtimeMs = 0;
+
+// Kernels before 5.7 stamp GPIO events from CLOCK_REALTIME rather than
+// CLOCK_MONOTONIC.  A timestamp that is in the future or older than any event
+// still waiting to be read can't be monotonic, so the read time is used.
+static constexpr std::chrono::seconds maxGPIOEventAge(60);
+
+static EventTime getGPIOEventTime(const gpiod::line_event& gpioLineEvent)
+{
+    EventTime now = std::chrono::steady_clock::now();
+    EventTime time(std::chrono::duration_cast<EventTime::duration>(
+        gpioLineEvent.timestamp));
+    if (time > now || now - time > maxGPIOEventAge)
+    {
+        return now;
+    }
+    return time;
+}
+
+static uint64_t getRealtimeMs(const EventTime time)
+{
+    // Project the monotonic time onto the wall clock as of now
+    auto age = std::chrono::steady_clock::now() - time;
+    auto realtime = std::chrono::system_clock::now() - age;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               realtime.time_since_epoch())
+        .count();
+}
+
+// The wall clock time is fixed when the change happens, so it doesn't move
+// between reads when the clock is stepped
+static void setPowerStateChangeTime(const EventTime time)
+{
+    powerStateChangeTime = time;
+    powerStateChangeRealtimeMs = getRealtimeMs(time);
+}
+
+// Outbound D-Bus calls.  Every call has a deadline and a bounded number of
+// retries, and each destination service has a circuit breaker so calls to a
+// service that has stopped answering fail fast instead of piling up.
+struct CallPolicy
+{
+    uint64_t timeoutUs;
+    int retries;
+};
+// Fire-and-forget notifications
+static constexpr CallPolicy notifyCallPolicy = {1000000, 0};
+// Calls whose results the daemon depends on
+static constexpr CallPolicy requiredCallPolicy = {2000000, 2};
+const static constexpr int callRetryDelayMs = 200;
+const static constexpr int circuitFailureThreshold = 3;
+const static constexpr int circuitOpenTimeMs = 30000;
+
+struct ServiceCircuit
+{
+    int consecutiveFailures = 0;
+    std::optional<EventTime> openUntil;
+};
+static boost::container::flat_map<std::string, ServiceCircuit> serviceCircuits;
+
+struct CallMetrics
+{
+    uint64_t outstanding = 0;
+    uint64_t maxOutstanding = 0;
+    uint64_t failed = 0;
+    uint64_t timedOut = 0;
+    uint64_t retried = 0;
+    // Calls failed fast because their service's circuit was open
+    uint64_t rejected = 0;
+};
+static CallMetrics callMetrics;
+
+static bool isCircuitOpen(const std::string& service)
+{
+    auto it = serviceCircuits.find(service);
+    return it != serviceCircuits.end() && it->second.openUntil &&
+           std::chrono::steady_clock::now() < *it->second.openUntil;
+}
+
+static void callSucceeded(const std::string& service)
+{
+    ServiceCircuit& circuit = serviceCircuits[service];
+    if (circuit.consecutiveFailures >= circuitFailureThreshold)
+    {
+        logInfo(LogSubsystem::dbus, "Calls to ", service, " recovered");
+    }
+    circuit = ServiceCircuit();
+}
+
+static void callFailed(const std::string& service,
+                       const boost::system::error_code& ec)
+{
+    callMetrics.failed++;
+    if (ec.value() == ETIMEDOUT)
+    {
+        callMetrics.timedOut++;
+    }
+    ServiceCircuit& circuit = serviceCircuits[service];
+    if (++circuit.consecutiveFailures >= circuitFailureThreshold)
+    {
+        // Open the circuit, or re-open it if the trial call failed
+        circuit.openUntil = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(circuitOpenTimeMs);
+        logError(LogSubsystem::dbus, "Calls to ", service,
+                 " failing, holding off for ", circuitOpenTimeMs, "ms");
+    }
+}
+
+// Forget a service's failures, e.g. once it has restarted
+static void resetCircuit(const std::string& service)
+{
+    serviceCircuits.erase(service);
+}
+
+// Call a method with the given policy.  The handler is called once, with the
+// reply or with the last error, and always after callMethod has returned.  The
+// reply types must be given explicitly.
+template <typename... Reply, typename Handler, typename... Args>
+static void callMethod(const CallPolicy& policy, const Handler& handler,
+                       const std::string& service, const std::string& path,
+                       const std::string& interface, const std::string& method,
+                       const Args&... args)
+{
+    if (isCircuitOpen(service))
+    {
+        callMetrics.rejected++;
+        boost::asio::post(io, [handler]() {
+            handler(boost::system::errc::make_error_code(
+                        boost::system::errc::host_unreachable),
+                    Reply()...);
+        });
+        return;
+    }
+
+    callMetrics.outstanding++;
+    callMetrics.maxOutstanding =
+        std::max(callMetrics.maxOutstanding, callMetrics.outstanding);
+    conn->async_method_call_timed(
+        [=](boost::system::error_code ec, Reply... reply) {
+            callMetrics.outstanding--;
+            if (!ec)
+            {
+                callSucceeded(service);
+                handler(ec, reply...);
+                return;
+            }
+            callFailed(service, ec);
+            if (policy.retries <= 0 || isCircuitOpen(service))
+            {
+                handler(ec, reply...);
+                return;
+            }
+            callMetrics.retried++;
+            CallPolicy retryPolicy = {policy.timeoutUs, policy.retries - 1};
+            auto retryTimer = std::make_shared<boost::asio::steady_timer>(
+                io, std::chrono::milliseconds(callRetryDelayMs));
+            retryTimer->async_wait(
+                [=](const boost::system::error_code&) {
+                    // Keep the timer alive until it has fired
+                    (void)retryTimer;
+                    callMethod<Reply...>(retryPolicy, handler, service, path,
+                                         interface, method, args...);
+                });
+        },
+        service, path, interface, method, policy.timeoutUs, args...);
+}
+
+static void beep(const uint8_t& beepPriority)
 {
-    std::cerr << "Moving to \"" << getPowerStateName(state) << "\" state.\n";
+    logInfo(LogSubsystem::dbus, "Beep with priority: ",
+            static_cast<unsigned>(beepPriority));
+
+    callMethod<>(
+        notifyCallPolicy,
+        [](boost::system::error_code ec) {
+            if (ec)
+            {
+                logError(LogSubsystem::dbus,
+                         "beep returned error with async_method_call (", ec,
+                         ")");
+                return;
+            }
+        },
+        "xyz.openbmc_project.BeepCode", "/xyz/openbmc_project/BeepCode",
+        "xyz.openbmc_project.BeepCode", "Beep", uint8_t(beepPriority));
 }
 
 enum class Event
@@ -210,7 +647,9 @@ enum class Event
     gracefulPowerCycleRequest,
     warmResetDetected,
 };
-static std::string getEventName(Event event)
+// Event currently being handled by the state machine
+static Event currentEvent;
+static const char* getEventName(Event event)
 {
     switch (event)
     {
@@ -278,14 +717,21 @@ static std::string getEventName(Event event)
             return "warm reset detected";
             break;
         default:
-            return "unknown event: " + std::to_string(static_cast<int>(event));
+            return "unknown event";
             break;
     }
 }
 static void logEvent(const std::string_view stateHandler, const Event event)
 {
-    std::cerr << stateHandler << ": " << getEventName(event)
-              << " event received.\n";
+    if (!logEnabled(LogSubsystem::stateMachine, LOG_INFO))
+    {
+        return;
+    }
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - eventTime);
+    logInfo(LogSubsystem::stateMachine, stateHandler, ": ",
+            getEventName(event), " event received (", latency.count(),
+            "us ago).");
 }
 
 // Power state handlers
@@ -344,577 +790,2591 @@ static std::function<void(const Event)> getPowerStateHandler(PowerState state)
     }
 };
 
-static void sendPowerControlEvent(const Event event)
+// Event dispatch metrics
+struct DispatchMetrics
 {
-    std::function<void(const Event)> handler = getPowerStateHandler(powerState);
-    if (handler == nullptr)
+    // Time from the event (GPIO edge, timer expiry, request) to its handler
+    uint64_t lastLatencyUs = 0;
+    uint64_t maxLatencyUs = 0;
+    // Time spent running the handler
+    uint64_t lastDurationUs = 0;
+    uint64_t maxDurationUs = 0;
+    // Time from a transition request to the resulting power state change
+    uint64_t lastRequestLatencyUs = 0;
+};
+static DispatchMetrics dispatchMetrics;
+// Time of the last transition request still waiting for a power state change,
+// and the state it was made in
+static std::optional<EventTime> pendingRequestTime;
+static PowerState pendingRequestState;
+
+static bool isTransitionRequest(const Event event)
+{
+    switch (event)
     {
-        std::cerr << "Failed to find handler for power state: "
-                  << static_cast<int>(powerState) << "\n";
-        return;
+        case Event::powerOnRequest:
+        case Event::powerOffRequest:
+        case Event::powerCycleRequest:
+        case Event::resetRequest:
+        case Event::gracefulPowerOffRequest:
+        case Event::gracefulPowerCycleRequest:
+            return true;
+            break;
+        default:
+            return false;
+            break;
     }
-    handler(event);
 }
 
-static uint64_t getCurrentTimeMs()
+static void recordDispatch(const EventTime dispatchStart)
 {
-    struct timespec time = {};
-
-    if (clock_gettime(CLOCK_REALTIME, &time) < 0)
-    {
-        return 0;
-    }
-    uint64_t currentTimeMs = static_cast<uint64_t>(time.tv_sec) * 1000;
-    currentTimeMs += static_cast<uint64_t>(time.tv_nsec) / 1000 / 1000;
+    auto dispatchEnd = std::chrono::steady_clock::now();
+    uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                             dispatchStart - eventTime)
+                             .count();
+    uint64_t durationUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                              dispatchEnd - dispatchStart)
+                              .count();
+    dispatchMetrics.lastLatencyUs = latencyUs;
+    dispatchMetrics.maxLatencyUs =
+        std::max(dispatchMetrics.maxLatencyUs, latencyUs);
+    dispatchMetrics.lastDurationUs = durationUs;
+    dispatchMetrics.maxDurationUs =
+        std::max(dispatchMetrics.maxDurationUs, durationUs);
+}
 
-    return currentTimeMs;
+// Property change batching.  Properties changed while an event is handled are
+// published together once it completes, as one PropertiesChanged signal per
+// interface rather than one per property.  Batched properties are registered
+// with getters that read the current state, so only their names are queued.
+struct PropertyChanges
+{
+    std::string path;
+    std::string interface;
+    boost::container::flat_set<std::string> names;
+};
+static std::vector<PropertyChanges> pendingPropertyChanges;
+static int propertyBatchDepth = 0;
+// PropertiesChanged signals emitted in total, and by the last batch
+static uint64_t propertiesChangedSignals = 0;
+static uint64_t lastBatchSignals = 0;
+
+template <typename T>
+static int rejectPropertySet(const T&, T&)
+{
+    throw std::invalid_argument("Property is read-only");
 }
 
-static constexpr std::string_view getHostState(const PowerState state)
+static void emitPropertiesChanged(const PropertyChanges& changes)
 {
-    switch (state)
+    std::vector<char*> names;
+    for (const std::string& name : changes.names)
     {
-        case PowerState::on:
-        case PowerState::gracefulTransitionToOff:
-        case PowerState::gracefulTransitionToCycleOff:
-            return "xyz.openbmc_project.State.Host.HostState.Running";
-            break;
-        case PowerState::waitForPSPowerOK:
-        case PowerState::waitForSIOPowerGood:
-        case PowerState::failedTransitionToOn:
-        case PowerState::off:
-        case PowerState::transitionToOff:
-        case PowerState::transitionToCycleOff:
-        case PowerState::cycleOff:
-        case PowerState::checkForWarmReset:
-            return "xyz.openbmc_project.State.Host.HostState.Off";
-            break;
-        default:
-            return "";
-            break;
+        names.push_back(const_cast<char*>(name.c_str()));
     }
-};
-static constexpr std::string_view getChassisState(const PowerState state)
-{
-    switch (state)
+    names.push_back(nullptr);
+    int r = sd_bus_emit_properties_changed_strv(
+        conn->get(), changes.path.c_str(), changes.interface.c_str(),
+        names.data());
+    if (r < 0)
     {
-        case PowerState::on:
-        case PowerState::transitionToOff:
-        case PowerState::gracefulTransitionToOff:
-        case PowerState::transitionToCycleOff:
-        case PowerState::gracefulTransitionToCycleOff:
-        case PowerState::checkForWarmReset:
-            return "xyz.openbmc_project.State.Chassis.PowerState.On";
-            break;
-        case PowerState::waitForPSPowerOK:
-        case PowerState::waitForSIOPowerGood:
-        case PowerState::failedTransitionToOn:
-        case PowerState::off:
-        case PowerState::cycleOff:
-            return "xyz.openbmc_project.State.Chassis.PowerState.Off";
-            break;
-        default:
-            return "";
-            break;
+        logError(LogSubsystem::dbus, "Failed to emit PropertiesChanged for ",
+                 changes.interface, ": ", strerror(-r));
+        return;
     }
-};
-static void savePowerState(const PowerState state)
+    propertiesChangedSignals++;
+}
+
+static void propertyChanged(const std::string& path,
+                            const std::string& interface,
+                            const std::string& name)
 {
-    powerStateSaveTimer.expires_after(
-        std::chrono::milliseconds(powerOffSaveTimeMs));
-    powerStateSaveTimer.async_wait([state](const boost::system::error_code ec) {
-        if (ec)
+    if (propertyBatchDepth == 0)
+    {
+        emitPropertiesChanged({path, interface, {name}});
+        return;
+    }
+    for (PropertyChanges& changes : pendingPropertyChanges)
+    {
+        if (changes.path == path && changes.interface == interface)
         {
-            // operation_aborted is expected if timer is canceled before
-            // completion.
-            if (ec != boost::asio::error::operation_aborted)
-            {
-                std::cerr << "Power-state save async_wait failed: "
-                          << ec.message() << "\n";
-            }
+            changes.names.insert(name);
             return;
         }
-        std::ofstream powerStateStream(powerControlDir / powerStateFile);
-        powerStateStream << getChassisState(state);
-    });
+    }
+    pendingPropertyChanges.push_back({path, interface, {name}});
 }
-static void setPowerState(const PowerState state)
+
+static void commitPropertyBatch()
 {
-    powerState = state;
-    logStateTransition(state);
+    if (--propertyBatchDepth > 0 || pendingPropertyChanges.empty())
+    {
+        return;
+    }
+    uint64_t signalsBefore = propertiesChangedSignals;
+    for (const PropertyChanges& changes : pendingPropertyChanges)
+    {
+        emitPropertiesChanged(changes);
+    }
+    pendingPropertyChanges.clear();
+    lastBatchSignals = propertiesChangedSignals - signalsBefore;
+}
+
+// Batches property changes for its lifetime.  The outermost batch emits them
+// when it ends, even if it ends with an exception.
+class PropertyBatch
+{
+  public:
+    PropertyBatch()
+    {
+        propertyBatchDepth++;
+    }
+    ~PropertyBatch()
+    {
+        commitPropertyBatch();
+    }
+    PropertyBatch(const PropertyBatch&) = delete;
+    PropertyBatch& operator=(const PropertyBatch&) = delete;
+};
 
-    hostIface->set_property("CurrentHostState",
-                            std::string(getHostState(powerState)));
+// Flight recorder.  Every state machine event is recorded in a ring mapped
+// from a file under /run, so the record outlives a crash or watchdog kill of
+// the daemon and is read back on the next start.  Recording is plain stores
+// into the mapping, with no system calls.
+const static std::filesystem::path flightRecorderFile =
+    "/run/power-control/flight-recorder";
+static constexpr uint32_t flightRecorderMagic = 0x52464350;
+static constexpr uint32_t flightRecorderVersion = 1;
+static constexpr uint32_t flightRecorderCapacity = 4096;
+// Number of the previous instance's last events logged on startup
+static constexpr size_t flightRecorderReplayCount = 16;
+static constexpr uint8_t flightRecorderIncomplete = 0xff;
+
+struct FlightRecorderEntry
+{
+    // 0 for an unused entry, or one being written
+    uint64_t sequence;
+    uint64_t monotonicNs;
+    uint32_t pid;
+    uint32_t durationNs;
+    uint8_t state;
+    uint8_t event;
+    // flightRecorderIncomplete until the event has been handled
+    uint8_t newState;
+    uint8_t reserved[5];
+};
+static_assert(sizeof(FlightRecorderEntry) == 32);
 
-    chassisIface->set_property("CurrentPowerState",
-                               std::string(getChassisState(powerState)));
-    chassisIface->set_property("LastStateChangeTime", getCurrentTimeMs());
+struct FlightRecorder
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t reserved;
+    FlightRecorderEntry entries[flightRecorderCapacity];
+};
+static FlightRecorder* flightRecorder = nullptr;
+static uint64_t flightRecorderSequence = 0;
+static uint32_t flightRecorderPid = 0;
 
-    // Save the power state for the restore policy
-    savePowerState(state);
+static uint64_t getMonotonicNs(const EventTime time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
 }
 
-enum class RestartCause
+static FlightRecorderEntry* flightRecorderBegin(const Event event,
+                                                const EventTime time)
 {
-    command,
-    resetButton,
-    powerButton,
-    watchdog,
-    powerPolicyOn,
-    powerPolicyRestore,
-    softReset,
-};
-static boost::container::flat_set<RestartCause> causeSet;
-static std::string getRestartCause(RestartCause cause)
+    if (flightRecorder == nullptr)
+    {
+        return nullptr;
+    }
+    uint64_t sequence = ++flightRecorderSequence;
+    FlightRecorderEntry& entry =
+        flightRecorder->entries[sequence % flightRecorderCapacity];
+    // Invalidate the entry while it is rewritten, in case we die part way
+    entry.sequence = 0;
+    std::atomic_signal_fence(std::memory_order_release);
+    entry.monotonicNs = getMonotonicNs(time);
+    entry.pid = flightRecorderPid;
+    entry.durationNs = 0;
+    entry.state = static_cast<uint8_t>(powerState);
+    entry.event = static_cast<uint8_t>(event);
+    entry.newState = flightRecorderIncomplete;
+    std::atomic_signal_fence(std::memory_order_release);
+    entry.sequence = sequence;
+    return &entry;
+}
+
+static void flightRecorderEnd(FlightRecorderEntry* entry,
+                              const EventTime dispatchStart)
 {
-    switch (cause)
+    if (entry == nullptr)
     {
-        case RestartCause::command:
-            return "xyz.openbmc_project.State.Host.RestartCause.IpmiCommand";
-            break;
-        case RestartCause::resetButton:
-            return "xyz.openbmc_project.State.Host.RestartCause.ResetButton";
-            break;
-        case RestartCause::powerButton:
-            return "xyz.openbmc_project.State.Host.RestartCause.PowerButton";
+        return;
+    }
+    entry->durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - dispatchStart)
+                            .count();
+    std::atomic_signal_fence(std::memory_order_release);
+    entry->newState = static_cast<uint8_t>(powerState);
+}
+
+static void flightRecorderReplay()
+{
+    std::vector<const FlightRecorderEntry*> entries;
+    for (uint32_t index = 0; index < flightRecorderCapacity; index++)
+    {
+        const FlightRecorderEntry& entry = flightRecorder->entries[index];
+        if (entry.sequence != 0 &&
+            entry.sequence % flightRecorderCapacity == index)
+        {
+            entries.push_back(&entry);
+        }
+    }
+    if (entries.empty())
+    {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const FlightRecorderEntry* a, const FlightRecorderEntry* b) {
+                  return a->sequence < b->sequence;
+              });
+    flightRecorderSequence = entries.back()->sequence;
+
+    auto getStateName = [](const uint8_t state) {
+        return state < power_event_journal::powerStateNames.size()
+                   ? getPowerStateName(static_cast<PowerState>(state))
+                   : "unknown";
+    };
+    uint64_t nowNs = getMonotonicNs(std::chrono::steady_clock::now());
+    std::cerr << "Flight recorder holds " << entries.size()
+              << " events, the last ones were:\n";
+    size_t first = entries.size() > flightRecorderReplayCount
+                       ? entries.size() - flightRecorderReplayCount
+                       : 0;
+    for (size_t index = first; index < entries.size(); index++)
+    {
+        const FlightRecorderEntry& entry = *entries[index];
+        std::cerr << "  " << (nowNs - entry.monotonicNs) / 1000000
+                  << "ms ago, pid " << entry.pid << ": "
+                  << getStateName(entry.state) << ": "
+                  << (entry.event < power_event_journal::eventNames.size()
+                          ? getEventName(static_cast<Event>(entry.event))
+                          : "unknown")
+                  << " -> "
+                  << (entry.newState == flightRecorderIncomplete
+                          ? std::string("(incomplete)")
+                          : getStateName(entry.newState))
+                  << "\n";
+    }
+    const FlightRecorderEntry& last = *entries.back();
+    if (last.newState == flightRecorderIncomplete)
+    {
+        std::cerr << "Previous instance (pid " << last.pid
+                  << ") stopped while handling an event in the \""
+                  << getStateName(last.state) << "\" state\n";
+    }
+}
+
+static void flightRecorderInit()
+{
+    flightRecorderPid = ::getpid();
+    std::error_code ec;
+    std::filesystem::create_directories(flightRecorderFile.parent_path(), ec);
+    int fd = ::open(flightRecorderFile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+                    0644);
+    if (fd < 0)
+    {
+        std::cerr << "failed to open " << flightRecorderFile << "\n";
+        return;
+    }
+    if (::ftruncate(fd, sizeof(FlightRecorder)) < 0)
+    {
+        std::cerr << "failed to size " << flightRecorderFile << "\n";
+        ::close(fd);
+        return;
+    }
+    void* map = ::mmap(nullptr, sizeof(FlightRecorder),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cerr << "failed to map " << flightRecorderFile << "\n";
+        return;
+    }
+    flightRecorder = static_cast<FlightRecorder*>(map);
+
+    if (flightRecorder->magic != flightRecorderMagic ||
+        flightRecorder->version != flightRecorderVersion ||
+        flightRecorder->capacity != flightRecorderCapacity)
+    {
+        std::memset(flightRecorder, 0, sizeof(FlightRecorder));
+        flightRecorder->magic = flightRecorderMagic;
+        flightRecorder->version = flightRecorderVersion;
+        flightRecorder->capacity = flightRecorderCapacity;
+        return;
+    }
+    flightRecorderReplay();
+}
+
+static void saveIntentCheckpoint();
+static void cancelRestorePowerOn();
+
+static void sendPowerControlEvent(const Event event, const EventTime time)
+{
+    std::function<void(const Event)> handler = getPowerStateHandler(powerState);
+    if (handler == nullptr)
+    {
+        std::cerr << "Failed to find handler for power state: "
+                  << static_cast<int>(powerState) << "\n";
+        return;
+    }
+    eventTime = time;
+    currentEvent = event;
+    if (isTransitionRequest(event))
+    {
+        pendingRequestTime = time;
+        pendingRequestState = powerState;
+    }
+    // A user's request overrides a restore power-on that is still staggered
+    if (isTransitionRequest(event) || event == Event::powerButtonPressed ||
+        event == Event::resetButtonPressed)
+    {
+        cancelRestorePowerOn();
+    }
+    PowerState stateBefore = powerState;
+    EventTime dispatchStart = std::chrono::steady_clock::now();
+    FlightRecorderEntry* flightRecorderEntry = flightRecorderBegin(event, time);
+    {
+        PropertyBatch propertyBatch;
+        handler(event);
+    }
+    flightRecorderEnd(flightRecorderEntry, dispatchStart);
+    if (powerState != stateBefore)
+    {
+        saveIntentCheckpoint();
+    }
+    else if (isTransitionRequest(event))
+    {
+        // The request was ignored or, like a reset, doesn't change the
+        // state, so there is no state change to measure it against
+        pendingRequestTime.reset();
+    }
+    recordDispatch(dispatchStart);
+}
+
+static void sendPowerControlEvent(const Event event)
+{
+    sendPowerControlEvent(event, std::chrono::steady_clock::now());
+}
+
+static constexpr std::string_view getHostState(const PowerState state)
+{
+    switch (state)
+    {
+        case PowerState::on:
+        case PowerState::gracefulTransitionToOff:
+        case PowerState::gracefulTransitionToCycleOff:
+            return "xyz.openbmc_project.State.Host.HostState.Running";
             break;
-        case RestartCause::watchdog:
-            return "xyz.openbmc_project.State.Host.RestartCause.WatchdogTimer";
+        case PowerState::waitForPSPowerOK:
+        case PowerState::waitForSIOPowerGood:
+        case PowerState::failedTransitionToOn:
+        case PowerState::off:
+        case PowerState::transitionToOff:
+        case PowerState::transitionToCycleOff:
+        case PowerState::cycleOff:
+        case PowerState::checkForWarmReset:
+            return "xyz.openbmc_project.State.Host.HostState.Off";
             break;
-        case RestartCause::powerPolicyOn:
-            return "xyz.openbmc_project.State.Host.RestartCause."
-                   "PowerPolicyAlwaysOn";
+        default:
+            return "";
             break;
-        case RestartCause::powerPolicyRestore:
-            return "xyz.openbmc_project.State.Host.RestartCause."
-                   "PowerPolicyPreviousState";
+    }
+};
+static constexpr std::string_view getChassisState(const PowerState state)
+{
+    switch (state)
+    {
+        case PowerState::on:
+        case PowerState::transitionToOff:
+        case PowerState::gracefulTransitionToOff:
+        case PowerState::transitionToCycleOff:
+        case PowerState::gracefulTransitionToCycleOff:
+        case PowerState::checkForWarmReset:
+            return "xyz.openbmc_project.State.Chassis.PowerState.On";
             break;
-        case RestartCause::softReset:
-            return "xyz.openbmc_project.State.Host.RestartCause.SoftReset";
+        case PowerState::waitForPSPowerOK:
+        case PowerState::waitForSIOPowerGood:
+        case PowerState::failedTransitionToOn:
+        case PowerState::off:
+        case PowerState::cycleOff:
+            return "xyz.openbmc_project.State.Chassis.PowerState.Off";
             break;
         default:
-            return "xyz.openbmc_project.State.Host.RestartCause.Unknown";
+            return "";
             break;
     }
+};
+// Flash wear accounting for everything written under powerControlDir
+struct FlashMetrics
+{
+    uint64_t writes = 0;
+    uint64_t bytesWritten = 0;
+    // Power state saves skipped because the saved state was unchanged
+    uint64_t skippedPowerStateWrites = 0;
+    uint64_t journalRecords = 0;
+};
+static FlashMetrics flashMetrics;
+
+// Write a file such that a crash leaves either its old or its new contents
+static bool writeFileAtomic(const std::filesystem::path& path,
+                            const std::string& contents)
+{
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0)
+    {
+        std::cerr << "failed to open " << tmpPath << "\n";
+        return false;
+    }
+    const char* data = contents.data();
+    size_t remaining = contents.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "failed to write " << tmpPath << "\n";
+            ::close(fd);
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    if (::fdatasync(fd) < 0)
+    {
+        std::cerr << "failed to sync " << tmpPath << "\n";
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+    if (::rename(tmpPath.c_str(), path.c_str()) < 0)
+    {
+        std::cerr << "failed to rename " << tmpPath << "\n";
+        return false;
+    }
+    // Sync the directory so the rename itself survives a power loss
+    int dirFd = ::open(path.parent_path().c_str(),
+                       O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0)
+    {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    flashMetrics.writes++;
+    flashMetrics.bytesWritten += contents.size();
+    return true;
+}
+
+// The power state file is one line holding the file format version, the
+// CRC-32 of the state and the state, so a torn or corrupt file is detected
+// rather than read as a state.
+const static constexpr int powerStateFileVersion = 1;
+// Chassis state last written to the power state file
+static std::string savedPowerState;
+
+static uint32_t getCRC32(const std::string& data)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(), data.size());
+    return crc.checksum();
+}
+
+static bool writePowerStateFile(const std::string& state)
+{
+    std::array<char, 9> crc;
+    std::snprintf(crc.data(), crc.size(), "%08x", getCRC32(state));
+    if (!writeFileAtomic(powerControlDir / powerStateFile,
+                         std::to_string(powerStateFileVersion) + " " +
+                             crc.data() + " " + state + "\n"))
+    {
+        return false;
+    }
+    savedPowerState = state;
+    return true;
+}
+
+static std::optional<std::string> readPowerStateFile()
+{
+    std::ifstream powerStateStream(powerControlDir / powerStateFile);
+    if (!powerStateStream.is_open())
+    {
+        std::cerr << "Failed to open power state file\n";
+        return std::nullopt;
+    }
+    std::string line;
+    std::getline(powerStateStream, line);
+
+    // Files from before the header was added only hold the state
+    if (line.rfind("xyz.openbmc_project.State.Chassis.PowerState.", 0) == 0)
+    {
+        return line;
+    }
+
+    std::istringstream lineStream(line);
+    int version = 0;
+    uint32_t crc = 0;
+    std::string state;
+    if (!(lineStream >> version >> std::hex >> crc >> state) ||
+        version != powerStateFileVersion || getCRC32(state) != crc)
+    {
+        std::cerr << "Power state file is corrupt\n";
+        return std::nullopt;
+    }
+    return state;
+}
+
+// Only saves of an unchanged state are dropped.  A change of state is always
+// written, since wasPowerDropped() reads the file after an AC loss.
+static void savePowerState(const PowerState state)
+{
+    std::string chassisState(getChassisState(state));
+    powerStateSaveTimer.expires_after(
+        std::chrono::milliseconds(powerOffSaveTimeMs));
+    powerStateSaveTimer.async_wait([chassisState](
+                                       const boost::system::error_code ec) {
+        if (ec)
+        {
+            // operation_aborted is expected if timer is canceled before
+            // completion.
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                std::cerr << "Power-state save async_wait failed: "
+                          << ec.message() << "\n";
+            }
+            return;
+        }
+        if (chassisState == savedPowerState)
+        {
+            flashMetrics.skippedPowerStateWrites++;
+            return;
+        }
+        writePowerStateFile(chassisState);
+    });
+}
+
+// Binary event journal.  Transitions, restart causes and power failures are
+// appended as fixed-size records, with no formatting, to a file under
+// powerControlDir that is rotated once it reaches maxJournalBytes.  Only
+// failure records are synced, the rest reach flash with normal writeback.
+const static constexpr size_t maxJournalBytes = 64 * 1024;
+static int journalFd = -1;
+static size_t journalBytes = 0;
+
+// The journal stores the daemon's enum values, so each entry of its name
+// tables must name the enumerator with that value
+#define ASSERT_JOURNAL_NAME(names, Enum, value)                                \
+    static_assert(std::string_view(power_event_journal::names.at(             \
+                      static_cast<size_t>(Enum::value))) == #value)
+static_assert(power_event_journal::powerStateNames.size() ==
+              static_cast<size_t>(PowerState::checkForWarmReset) + 1);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, on);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, waitForPSPowerOK);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, waitForSIOPowerGood);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, failedTransitionToOn);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, off);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, transitionToOff);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, gracefulTransitionToOff);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, cycleOff);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, transitionToCycleOff);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, gracefulTransitionToCycleOff);
+ASSERT_JOURNAL_NAME(powerStateNames, PowerState, checkForWarmReset);
+static_assert(power_event_journal::eventNames.size() ==
+              static_cast<size_t>(Event::warmResetDetected) + 1);
+ASSERT_JOURNAL_NAME(eventNames, Event, psPowerOKAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, psPowerOKDeAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, sioPowerGoodAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, sioPowerGoodDeAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, sioS5Assert);
+ASSERT_JOURNAL_NAME(eventNames, Event, sioS5DeAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, postCompleteAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, postCompleteDeAssert);
+ASSERT_JOURNAL_NAME(eventNames, Event, powerButtonPressed);
+ASSERT_JOURNAL_NAME(eventNames, Event, resetButtonPressed);
+ASSERT_JOURNAL_NAME(eventNames, Event, powerCycleTimerExpired);
+ASSERT_JOURNAL_NAME(eventNames, Event, psPowerOKWatchdogTimerExpired);
+ASSERT_JOURNAL_NAME(eventNames, Event, sioPowerGoodWatchdogTimerExpired);
+ASSERT_JOURNAL_NAME(eventNames, Event, gracefulPowerOffTimerExpired);
+ASSERT_JOURNAL_NAME(eventNames, Event, powerOnRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, powerOffRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, powerCycleRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, resetRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, gracefulPowerOffRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, gracefulPowerCycleRequest);
+ASSERT_JOURNAL_NAME(eventNames, Event, warmResetDetected);
+
+static void openEventJournal()
+{
+    std::filesystem::path journalPath =
+        powerControlDir / power_event_journal::journalFile;
+    journalFd = ::open(journalPath.c_str(),
+                       O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journalFd < 0)
+    {
+        std::cerr << "failed to open " << journalPath << "\n";
+        return;
+    }
+    struct stat journalStat = {};
+    if (::fstat(journalFd, &journalStat) == 0)
+    {
+        journalBytes = journalStat.st_size;
+    }
+    // Drop a record torn by a crash so the records after it stay aligned
+    size_t tornBytes = journalBytes % sizeof(power_event_journal::Record);
+    if (tornBytes != 0 && ::ftruncate(journalFd, journalBytes - tornBytes) == 0)
+    {
+        journalBytes -= tornBytes;
+    }
+}
+
+static void rotateEventJournal()
+{
+    ::close(journalFd);
+    journalFd = -1;
+    journalBytes = 0;
+    std::error_code ec;
+    std::filesystem::rename(
+        powerControlDir / power_event_journal::journalFile,
+        powerControlDir / power_event_journal::rotatedJournalFile, ec);
+    if (ec)
+    {
+        std::cerr << "failed to rotate the event journal: " << ec.message()
+                  << "\n";
+    }
+    openEventJournal();
+}
+
+static void appendJournalRecord(power_event_journal::Record record,
+                                const EventTime time, const bool sync)
+{
+    if (journalFd < 0)
+    {
+        return;
+    }
+    if (journalBytes + sizeof(record) > maxJournalBytes)
+    {
+        rotateEventJournal();
+        if (journalFd < 0)
+        {
+            return;
+        }
+    }
+    record.magic = power_event_journal::recordMagic;
+    record.realtimeMs = getRealtimeMs(time);
+    record.monotonicUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                             time.time_since_epoch())
+                             .count();
+    record.crc = power_event_journal::getRecordCRC(record);
+    if (::write(journalFd, &record, sizeof(record)) != sizeof(record))
+    {
+        std::cerr << "failed to append to the event journal\n";
+        return;
+    }
+    journalBytes += sizeof(record);
+    flashMetrics.journalRecords++;
+    flashMetrics.bytesWritten += sizeof(record);
+    if (sync)
+    {
+        ::fdatasync(journalFd);
+    }
+}
+
+static void journalPowerState(const power_event_journal::RecordType type,
+                              const PowerState fromState,
+                              const PowerState toState, const uint8_t code,
+                              const EventTime time, const bool sync)
+{
+    power_event_journal::Record record = {};
+    record.type = type;
+    record.fromState = static_cast<uint8_t>(fromState);
+    record.toState = static_cast<uint8_t>(toState);
+    record.code = code;
+    appendJournalRecord(record, time, sync);
+}
+// In-process power state observers, called synchronously on each transition.
+// Publication on D-Bus is separate, through the batched property changes.
+using PowerStateObserver =
+    std::function<void(const PowerState oldState, const PowerState newState)>;
+static std::vector<PowerStateObserver> powerStateObservers;
+
+static void addPowerStateObserver(const PowerStateObserver& observer)
+{
+    powerStateObservers.push_back(observer);
+}
+
+static void recordRequestLatency(const PowerState oldState,
+                                 const PowerState newState)
+{
+    if (!pendingRequestTime)
+    {
+        return;
+    }
+    // A request that ends up back where it started, like a graceful power-off
+    // that times out, never got the state change it asked for
+    if (newState == pendingRequestState)
+    {
+        pendingRequestTime.reset();
+        return;
+    }
+    if (getChassisState(oldState) == getChassisState(newState))
+    {
+        return;
+    }
+    dispatchMetrics.lastRequestLatencyUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            powerStateChangeTime - *pendingRequestTime)
+            .count();
+    pendingRequestTime.reset();
+    logInfo(LogSubsystem::dbus, "CurrentPowerState changed ",
+            dispatchMetrics.lastRequestLatencyUs,
+            "us after the transition request");
+}
+
+// Transitions are logged with structured fields so that they can be
+// filtered from the journal without parsing the message
+static void logTransition(const PowerState from, const PowerState to)
+{
+    if (!logEnabled(LogSubsystem::stateMachine, LOG_INFO))
+    {
+        return;
+    }
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - eventTime);
+    logInfo(LogSubsystem::stateMachine, "Moving to \"", getPowerStateName(to),
+            "\" state.", LogField{"POWER_STATE_FROM"}, getPowerStateName(from),
+            LogField{"POWER_STATE_TO"}, getPowerStateName(to),
+            LogField{"EVENT"}, getEventName(currentEvent),
+            LogField{"HOST_ID"}, hostId, LogField{"LATENCY_US"},
+            latency.count(), LogField{"MONOTONIC_NS"},
+            getMonotonicNs(eventTime));
+}
+
+static void setPowerState(const PowerState state)
+{
+    PowerState oldState = powerState;
+    powerState = state;
+    setPowerStateChangeTime(eventTime);
+    logTransition(oldState, state);
+    journalPowerState(power_event_journal::RecordType::transition, oldState,
+                      state, static_cast<uint8_t>(currentEvent),
+                      powerStateChangeTime, false);
+    recordRequestLatency(oldState, state);
+
+    if (getHostState(oldState) != getHostState(state))
+    {
+        propertyChanged(hostPath, hostInterface, "CurrentHostState");
+    }
+    if (getChassisState(oldState) != getChassisState(state))
+    {
+        propertyChanged(chassisPath, chassisInterface, "CurrentPowerState");
+    }
+    propertyChanged(chassisPath, chassisInterface, "LastStateChangeTime");
+
+    for (const PowerStateObserver& observer : powerStateObservers)
+    {
+        observer(oldState, state);
+    }
+
+    // Save the power state for the restore policy
+    savePowerState(state);
+}
+
+enum class RestartCause
+{
+    command,
+    resetButton,
+    powerButton,
+    watchdog,
+    powerPolicyOn,
+    powerPolicyRestore,
+    softReset,
+};
+static_assert(power_event_journal::restartCauseNames.size() ==
+              static_cast<size_t>(RestartCause::softReset) + 1);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, command);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, resetButton);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, powerButton);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, watchdog);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, powerPolicyOn);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, powerPolicyRestore);
+ASSERT_JOURNAL_NAME(restartCauseNames, RestartCause, softReset);
+#undef ASSERT_JOURNAL_NAME
+static boost::container::flat_set<RestartCause> causeSet;
+static std::string getRestartCause(RestartCause cause)
+{
+    switch (cause)
+    {
+        case RestartCause::command:
+            return "xyz.openbmc_project.State.Host.RestartCause.IpmiCommand";
+            break;
+        case RestartCause::resetButton:
+            return "xyz.openbmc_project.State.Host.RestartCause.ResetButton";
+            break;
+        case RestartCause::powerButton:
+            return "xyz.openbmc_project.State.Host.RestartCause.PowerButton";
+            break;
+        case RestartCause::watchdog:
+            return "xyz.openbmc_project.State.Host.RestartCause.WatchdogTimer";
+            break;
+        case RestartCause::powerPolicyOn:
+            return "xyz.openbmc_project.State.Host.RestartCause."
+                   "PowerPolicyAlwaysOn";
+            break;
+        case RestartCause::powerPolicyRestore:
+            return "xyz.openbmc_project.State.Host.RestartCause."
+                   "PowerPolicyPreviousState";
+            break;
+        case RestartCause::softReset:
+            return "xyz.openbmc_project.State.Host.RestartCause.SoftReset";
+            break;
+        default:
+            return "xyz.openbmc_project.State.Host.RestartCause.Unknown";
+            break;
+    }
+}
+static void addRestartCause(const RestartCause cause)
+{
+    // Add this to the set of causes for this restart
+    causeSet.insert(cause);
+}
+static void clearRestartCause()
+{
+    // Clear the set for the next restart
+    causeSet.clear();
+}
+static void setRestartCauseProperty(const std::string& cause)
+{
+    logInfo(LogSubsystem::dbus, "RestartCause set to ", cause);
+    currentRestartCause = cause;
+    restartCauseIface->set_property("RestartCause", cause);
+}
+static void setRestartCause()
+{
+    // Determine the actual restart cause based on the set of causes
+    std::string restartCause =
+        "xyz.openbmc_project.State.Host.RestartCause.Unknown";
+    if (causeSet.contains(RestartCause::watchdog))
+    {
+        restartCause = getRestartCause(RestartCause::watchdog);
+    }
+    else if (causeSet.contains(RestartCause::command))
+    {
+        restartCause = getRestartCause(RestartCause::command);
+    }
+    else if (causeSet.contains(RestartCause::resetButton))
+    {
+        restartCause = getRestartCause(RestartCause::resetButton);
+    }
+    else if (causeSet.contains(RestartCause::powerButton))
+    {
+        restartCause = getRestartCause(RestartCause::powerButton);
+    }
+    else if (causeSet.contains(RestartCause::powerPolicyOn))
+    {
+        restartCause = getRestartCause(RestartCause::powerPolicyOn);
+    }
+    else if (causeSet.contains(RestartCause::powerPolicyRestore))
+    {
+        restartCause = getRestartCause(RestartCause::powerPolicyRestore);
+    }
+    else if (causeSet.contains(RestartCause::softReset))
+    {
+        restartCause = getRestartCause(RestartCause::softReset);
+    }
+
+    power_event_journal::Record record = {};
+    record.type = power_event_journal::RecordType::restartCause;
+    record.code = power_event_journal::unknownCode;
+    for (const RestartCause cause : causeSet)
+    {
+        record.data |= 1U << static_cast<unsigned>(cause);
+        if (getRestartCause(cause) == restartCause)
+        {
+            record.code = static_cast<uint8_t>(cause);
+        }
+    }
+    appendJournalRecord(record, std::chrono::steady_clock::now(), false);
+
+    setRestartCauseProperty(restartCause);
+}
+
+static void systemPowerGoodFailedLog()
+{
+    journalPowerState(power_event_journal::RecordType::systemPowerGoodFailed,
+                      powerState, powerState, power_event_journal::unknownCode,
+                      eventTime, true);
+    sd_journal_send(
+        "MESSAGE=PowerControl: system power good failed to assert (VR failure)",
+        "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+        "OpenBMC.0.1.SystemPowerGoodFailed", "REDFISH_MESSAGE_ARGS=%d",
+        sioPowerGoodWatchdogTimeMs, "POWER_STATE=%s",
+        getPowerStateName(powerState), "HOST_ID=%d", hostId,
+        "MONOTONIC_NS=%" PRIu64, getMonotonicNs(eventTime), NULL);
+}
+
+static void psPowerOKFailedLog()
+{
+    journalPowerState(power_event_journal::RecordType::psPowerOKFailed,
+                      powerState, powerState, power_event_journal::unknownCode,
+                      eventTime, true);
+    sd_journal_send(
+        "MESSAGE=PowerControl: power supply power good failed to assert",
+        "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+        "OpenBMC.0.1.PowerSupplyPowerGoodFailed", "REDFISH_MESSAGE_ARGS=%d",
+        psPowerOKWatchdogTimeMs, "POWER_STATE=%s",
+        getPowerStateName(powerState), "HOST_ID=%d", hostId,
+        "MONOTONIC_NS=%" PRIu64, getMonotonicNs(eventTime), NULL);
+}
+
+static void powerRestorePolicyLog()
+{
+    sd_journal_send("MESSAGE=PowerControl: power restore policy applied",
+                    "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+                    "OpenBMC.0.1.PowerRestorePolicyApplied", NULL);
+}
+
+static void powerButtonPressLog()
+{
+    sd_journal_send("MESSAGE=PowerControl: power button pressed", "PRIORITY=%i",
+                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+                    "OpenBMC.0.1.PowerButtonPressed", NULL);
+}
+
+static void resetButtonPressLog()
+{
+    sd_journal_send("MESSAGE=PowerControl: reset button pressed", "PRIORITY=%i",
+                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+                    "OpenBMC.0.1.ResetButtonPressed", NULL);
+}
+
+static void nmiButtonPressLog()
+{
+    sd_journal_send("MESSAGE=PowerControl: NMI button pressed", "PRIORITY=%i",
+                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+                    "OpenBMC.0.1.NMIButtonPressed", NULL);
+}
+
+static void nmiDiagIntLog()
+{
+    sd_journal_send("MESSAGE=PowerControl: NMI Diagnostic Interrupt",
+                    "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
+                    "OpenBMC.0.1.NMIDiagnosticInterrupt", NULL);
+}
+
+static void registerMetric(const std::string& name, const uint64_t& metric)
+{
+    // Metrics are read on demand rather than signalled, so that recording
+    // them does not cost a PropertiesChanged broadcast per event
+    metricsIface->register_property(
+        name, metric, rejectPropertySet<uint64_t>,
+        [&metric](const uint64_t&) { return metric; });
+}
+
+static std::optional<int> getLogLevel(const std::string_view name)
+{
+    for (size_t level = 0; level < logLevelNames.size(); level++)
+    {
+        if (name == logLevelNames[level])
+        {
+            return level;
+        }
+    }
+    return std::nullopt;
+}
+
+static void saveLogLevels()
+{
+    std::string contents;
+    for (size_t subsystem = 0; subsystem < logLevels.size(); subsystem++)
+    {
+        contents += std::string(logSubsystemNames[subsystem]) + " " +
+                    logLevelNames[logLevels[subsystem]] + "\n";
+    }
+    writeFileAtomic(powerControlDir / logLevelsFile, contents);
+}
+
+static void logLevelsInit()
+{
+    std::ifstream logLevelsStream(powerControlDir / logLevelsFile);
+    std::string subsystemName;
+    std::string levelName;
+    while (logLevelsStream >> subsystemName >> levelName)
+    {
+        std::optional<int> level = getLogLevel(levelName);
+        auto subsystem = std::find(logSubsystemNames.begin(),
+                                   logSubsystemNames.end(), subsystemName);
+        if (!level || subsystem == logSubsystemNames.end())
+        {
+            std::cerr << "Ignoring log level " << levelName << " for "
+                      << subsystemName << "\n";
+            continue;
+        }
+        logLevels[subsystem - logSubsystemNames.begin()] = *level;
+    }
+}
+
+static void registerLogLevel(const size_t subsystem)
+{
+    loggingIface->register_property(
+        std::string(logSubsystemNames[subsystem]) + "LogLevel",
+        std::string(logLevelNames[logLevels[subsystem]]),
+        [subsystem](const std::string& requested, std::string& resp) {
+            std::optional<int> level = getLogLevel(requested);
+            if (!level)
+            {
+                throw std::invalid_argument("Unrecognized log level");
+            }
+            logLevels[subsystem] = *level;
+            saveLogLevels();
+            resp = requested;
+            return 1;
+        });
+}
+
+static int initializePowerStateStorage()
+{
+    // create the power control directory if it doesn't exist
+    std::error_code ec;
+    if (!(std::filesystem::create_directories(powerControlDir, ec)))
+    {
+        if (ec.value() != 0)
+        {
+            std::cerr << "failed to create " << powerControlDir << ": "
+                      << ec.message() << "\n";
+            return -1;
+        }
+    }
+    // Create the power state file if it doesn't exist
+    if (!std::filesystem::exists(powerControlDir / powerStateFile))
+    {
+        writePowerStateFile(std::string(getChassisState(powerState)));
+    }
+    else
+    {
+        savedPowerState = readPowerStateFile().value_or("");
+    }
+    return 0;
+}
+
+// Startup timing.  Startup runs its D-Bus requests concurrently with the
+// GPIO setup, and the time each phase completed is reported once they have
+// all finished.
+static EventTime startupStartTime;
+static std::vector<std::pair<std::string, EventTime>> startupPhases;
+// Startup requests still outstanding, including main() itself
+static int startupPending = 1;
+static uint64_t startupReadyMs = 0;
+
+static void startupPhaseDone(const std::string& phase)
+{
+    startupPhases.emplace_back(phase, std::chrono::steady_clock::now());
+}
+
+static void startupRequestDone(const std::string& phase)
+{
+    startupPhaseDone(phase);
+    if (--startupPending > 0)
+    {
+        return;
+    }
+
+    std::sort(startupPhases.begin(), startupPhases.end(),
+              [](const auto& a, const auto& b) { return a.second < b.second; });
+    EventTime previous = startupStartTime;
+    std::cerr << "Startup timing:\n";
+    for (const auto& [name, time] : startupPhases)
+    {
+        std::cerr << "  " << name << ": "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         time - startupStartTime)
+                         .count()
+                  << "ms (+"
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         time - previous)
+                         .count()
+                  << "ms)\n";
+        previous = time;
+    }
+    startupReadyMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         previous - startupStartTime)
+                         .count();
+    std::cerr << "Chassis power control service ready in " << startupReadyMs
+              << "ms\n";
+}
+
+// Set when the daemon can't run as it should, to exit with a failure so
+// systemd restarts it
+static bool fatalError = false;
+
+// Request the bus names without waiting for each reply in turn.  Failing to
+// own any of them is fatal, as clients would not find the objects.
+static void requestNames(const std::vector<std::string>& names)
+{
+    static size_t namesPending = 0;
+    namesPending += names.size();
+    startupPending++;
+    for (const std::string& name : names)
+    {
+        callMethod<uint32_t>(
+            requiredCallPolicy,
+            [name](boost::system::error_code ec, uint32_t result) {
+                // DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER, or
+                // DBUS_REQUEST_NAME_REPLY_ALREADY_OWNER when a retry follows
+                // an attempt that timed out here but succeeded on the bus
+                if (ec || (result != 1 && result != 4))
+                {
+                    std::cerr << "failed to acquire " << name << "\n";
+                    fatalError = true;
+                    io.stop();
+                    return;
+                }
+                if (--namesPending == 0)
+                {
+                    startupRequestDone("D-Bus names acquired");
+                }
+            },
+            "org.freedesktop.DBus", "/org/freedesktop/DBus",
+            "org.freedesktop.DBus", "RequestName", name, uint32_t(0));
+    }
+}
+
+// Settings cache.  The settings this daemon uses are loaded from
+// xyz.openbmc_project.Settings with a single GetManagedObjects call and kept
+// current by a single PropertiesChanged match, so they can be read
+// synchronously.  The cache is reloaded whenever the Settings service
+// (re)starts.
+static constexpr const char* settingsService = "xyz.openbmc_project.Settings";
+
+struct Setting
+{
+    const char* path;
+    const char* interface;
+    const char* property;
+};
+static constexpr Setting acBootSetting = {
+    "/xyz/openbmc_project/control/host0/ac_boot",
+    "xyz.openbmc_project.Common.ACBoot", "ACBoot"};
+static constexpr Setting powerRestoreDelaySetting = {
+    "/xyz/openbmc_project/control/power_restore_delay",
+    "xyz.openbmc_project.Control.Power.RestoreDelay", "PowerRestoreDelay"};
+static constexpr Setting powerRestorePolicySetting = {
+    "/xyz/openbmc_project/control/host0/power_restore_policy",
+    "xyz.openbmc_project.Control.Power.RestorePolicy", "PowerRestorePolicy"};
+static constexpr Setting pohCounterSetting = {
+    "/xyz/openbmc_project/state/chassis0",
+    "xyz.openbmc_project.State.PowerOnHours", "POHCounter"};
+static constexpr Setting nmiEnabledSetting = {
+    "/xyz/openbmc_project/Chassis/Control/NMISource",
+    "xyz.openbmc_project.Chassis.Control.NMISource", "Enabled"};
+static constexpr std::array<Setting, 5> cachedSettings = {
+    acBootSetting, powerRestoreDelaySetting, powerRestorePolicySetting,
+    pohCounterSetting, nmiEnabledSetting};
+
+using SettingsValue =
+    std::variant<bool, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t,
+                 uint64_t, double, std::string, std::vector<std::string>>;
+using SettingsProperties =
+    boost::container::flat_map<std::string, SettingsValue>;
+using SettingsObjects = std::vector<std::pair<
+    sdbusplus::message::object_path,
+    boost::container::flat_map<std::string, SettingsProperties>>>;
+using SettingKey = std::tuple<std::string, std::string, std::string>;
+
+// Watch callbacks return true once they no longer need to be called
+using SettingCallback = std::function<bool(const SettingsValue&)>;
+struct SettingWatch
+{
+    SettingKey key;
+    SettingCallback callback;
+    // Whether to call back with the value first loaded, or only on changes
+    bool notifyLoaded;
+};
+
+static boost::container::flat_map<SettingKey, SettingsValue> settingsCache;
+static std::vector<SettingWatch> settingWatches;
+
+static SettingKey getSettingKey(const Setting& setting)
+{
+    return {setting.path, setting.interface, setting.property};
+}
+
+template <typename T>
+static std::optional<T> getSetting(const Setting& setting)
+{
+    auto it = settingsCache.find(getSettingKey(setting));
+    if (it == settingsCache.end())
+    {
+        return std::nullopt;
+    }
+    const T* value = std::get_if<T>(&it->second);
+    if (value == nullptr)
+    {
+        return std::nullopt;
+    }
+    return *value;
+}
+
+static void notifySettingWatches(const SettingKey& key,
+                                 const SettingsValue& value, bool loaded)
+{
+    // Callbacks may add watches, so walk a copy
+    std::vector<SettingWatch> watches;
+    watches.swap(settingWatches);
+    for (SettingWatch& watch : watches)
+    {
+        if (watch.key == key && (watch.notifyLoaded || !loaded) &&
+            watch.callback(value))
+        {
+            continue;
+        }
+        settingWatches.push_back(std::move(watch));
+    }
+}
+
+// Returns whether the cached value changed
+static bool updateSetting(const SettingKey& key, const SettingsValue& value)
+{
+    auto it = settingsCache.find(key);
+    if (it == settingsCache.end())
+    {
+        settingsCache.emplace(key, value);
+        notifySettingWatches(key, value, true);
+        return true;
+    }
+    if (it->second == value)
+    {
+        return false;
+    }
+    it->second = value;
+    notifySettingWatches(key, value, false);
+    return true;
+}
+
+static bool isCachedSetting(const SettingKey& key)
+{
+    for (const Setting& setting : cachedSettings)
+    {
+        if (getSettingKey(setting) == key)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Call back with the setting's value, now if it is cached or else once it is
+// loaded, and then on every change until the callback returns true
+static void watchSetting(const Setting& setting,
+                         const SettingCallback& callback)
+{
+    SettingKey key = getSettingKey(setting);
+    auto it = settingsCache.find(key);
+    if (it != settingsCache.end() && callback(it->second))
+    {
+        return;
+    }
+    settingWatches.push_back({key, callback, it == settingsCache.end()});
+}
+
+// Call back on every change to the setting's value, but not on its first load
+static void watchSettingChanges(const Setting& setting,
+                                const SettingCallback& callback)
+{
+    settingWatches.push_back({getSettingKey(setting), callback, false});
+}
+
+static void loadSettings()
+{
+    callMethod<SettingsObjects>(
+        requiredCallPolicy,
+        [](boost::system::error_code ec, const SettingsObjects& objects) {
+            // The first load completes startup whether or not it succeeds
+            static bool startupLoad = true;
+            bool firstLoad = startupLoad;
+            startupLoad = false;
+            if (firstLoad)
+            {
+                startupRequestDone(ec ? "Settings unavailable"
+                                      : "Settings loaded");
+            }
+            if (ec)
+            {
+                // Settings is not up yet, the cache loads when it starts
+                return;
+            }
+            for (const auto& [path, interfaces] : objects)
+            {
+                for (const auto& [interface, properties] : interfaces)
+                {
+                    for (const auto& [property, value] : properties)
+                    {
+                        SettingKey key{path, interface, property};
+                        if (isCachedSetting(key))
+                        {
+                            updateSetting(key, value);
+                        }
+                    }
+                }
+            }
+            std::cerr << "Settings cache loaded\n";
+        },
+        settingsService, "/", "org.freedesktop.DBus.ObjectManager",
+        "GetManagedObjects");
+}
+
+// D-Bus matches.  Each match is scoped to its exact sender and path, and
+// counts the messages delivered to it against those it acted on.
+struct MatchCounters
+{
+    uint64_t delivered = 0;
+    uint64_t actedOn = 0;
+};
+static boost::container::flat_map<std::string, MatchCounters> matchCounters;
+static std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+
+// The handler returns whether it acted on the message
+static void addMatch(
+    const std::string& name, const std::string& rule,
+    const std::function<bool(sdbusplus::message::message&)>& handler)
+{
+    matchCounters[name] = MatchCounters();
+    matches.push_back(std::make_unique<sdbusplus::bus::match::match>(
+        *conn, rule, [name, handler](sdbusplus::message::message& msg) {
+            MatchCounters& counters = matchCounters[name];
+            counters.delivered++;
+            if (handler(msg))
+            {
+                counters.actedOn++;
+            }
+        }));
+}
+
+using MatchCounts = boost::container::flat_map<std::string, uint64_t>;
+static MatchCounts getMatchCounts(
+    const std::function<uint64_t(const MatchCounters&)>& getCount)
+{
+    MatchCounts matchCounts;
+    for (const auto& [name, counters] : matchCounters)
+    {
+        matchCounts[name] = getCount(counters);
+    }
+    return matchCounts;
+}
+
+static void settingsCacheInit()
+{
+    // One match per cached setting, on its own object and interface
+    for (const Setting& setting : cachedSettings)
+    {
+        std::string name = std::string("Settings:") + setting.path + ":" +
+                           setting.interface;
+        if (matchCounters.contains(name))
+        {
+            // Another setting on the same interface is already matched
+            continue;
+        }
+        addMatch(
+            name,
+            std::string("type='signal',sender='") + settingsService +
+                "',path='" + setting.path +
+                "',interface='org.freedesktop.DBus.Properties',"
+                "member='PropertiesChanged',arg0='" +
+                setting.interface + "'",
+            [](sdbusplus::message::message& msg) {
+                std::string interfaceName;
+                SettingsProperties propertiesChanged;
+                try
+                {
+                    msg.read(interfaceName, propertiesChanged);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Unable to read changed settings\n";
+                    return false;
+                }
+                std::string path = msg.get_path();
+                bool changed = false;
+                for (const auto& [property, value] : propertiesChanged)
+                {
+                    SettingKey key{path, interfaceName, property};
+                    if (isCachedSetting(key) && updateSetting(key, value))
+                    {
+                        changed = true;
+                    }
+                }
+                return changed;
+            });
+    }
+
+    addMatch(
+        "SettingsOwner",
+        std::string("type='signal',sender='org.freedesktop.DBus',"
+                    "path='/org/freedesktop/DBus',"
+                    "interface='org.freedesktop.DBus',"
+                    "member='NameOwnerChanged',arg0='") +
+            settingsService + "'",
+        [](sdbusplus::message::message& msg) {
+            std::string name;
+            std::string oldOwner;
+            std::string newOwner;
+            try
+            {
+                msg.read(name, oldOwner, newOwner);
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << "Unable to read Settings owner change\n";
+                return false;
+            }
+            if (newOwner.empty())
+            {
+                return false;
+            }
+            resetCircuit(settingsService);
+            loadSettings();
+            return true;
+        });
+
+    startupPending++;
+    loadSettings();
+}
+
+static bool wasPowerDropped()
+{
+    return readPowerStateFile() ==
+           "xyz.openbmc_project.State.Chassis.PowerState.On";
+}
+
+// Local mirror of the last restore policy settings.  The policy is started
+// from it as soon as the daemon starts, rather than after Settings has
+// answered for ACBoot, the delay and the policy in turn, and is reconciled
+// with Settings once it is up.
+struct RestorePolicy
+{
+    std::string policy;
+    uint16_t delay = 0;
+    // Whether Settings has ever published ACBoot.  Without it the policy is
+    // never started from Settings, so it is not started from the mirror.
+    bool acBootKnown = true;
+};
+static std::optional<RestorePolicy> localRestorePolicy;
+static bool restorePolicyFromMirror = false;
+static bool restorePolicyInvoked = false;
+// The restore delay has run out, so later delay changes no longer apply
+static bool restoreDelayExpired = false;
+// Whether Settings has reported ACBoot=True in this boot
+static bool acBootReported = false;
+static boost::asio::steady_timer acBootWaitTimer(io);
+static boost::asio::steady_timer powerRestorePolicyTimer(io);
+static std::optional<int> powerRestorePolicyTimerDelay;
+
+// Firmware boot time, counted against the restore delay along with the time
+// since the kernel started.  A measured time read from FirmwareBootTimeFile
+// is preferred to the configured FirmwareBootTimeMs.
+struct RestoreDelayConfig
+{
+    uint64_t firmwareBootTimeMs = 20000;
+    std::filesystem::path firmwareBootTimeFile;
+    // How long a policy started from the mirror waits for Settings to report
+    // ACBoot once its delay has expired
+    uint32_t acBootWaitMs = 10000;
+};
+static RestoreDelayConfig restoreDelayConfig;
+
+// The budget applied to the last restore delay, for verification
+struct RestoreDelayBudget
+{
+    uint64_t firmwareMs = 0;
+    uint64_t bootTimeMs = 0;
+    uint64_t timerMs = 0;
+};
+static RestoreDelayBudget restoreDelayBudget;
+
+// Staggered restore.  Policy power-ons are delayed by a jitter derived from
+// the board identity, spread over StaggerWindowMs, so that the nodes of a
+// rack don't all power on at once after a power event.  Hosts sharing a
+// power budget can also take turns through a power token, a lock file held
+// from the power-on request until the host is on or has failed to power on.
+struct RestoreStaggerConfig
+{
+    uint32_t windowMs = 0;
+    std::filesystem::path identityFile = "/sys/class/net/eth0/address";
+    std::filesystem::path powerTokenFile;
+    uint32_t powerTokenTimeoutMs = 30000;
+};
+static RestoreStaggerConfig restoreStaggerConfig;
+static constexpr int powerTokenPollMs = 100;
+static boost::asio::steady_timer restoreStaggerTimer(io);
+// A restore power-on is waiting out its jitter or for the power token
+static bool restoreStaggerPending = false;
+static int powerTokenFd = -1;
+static bool powerTokenHeld = false;
+static uint64_t restoreJitterMs = 0;
+static uint64_t powerTokenWaitMs = 0;
+
+// Time from AC on to the host powering on for the last restore, and whether
+// the restore was started from the mirror
+static uint64_t acRestoreLatencyMs = 0;
+static uint64_t acRestoreFromMirror = 0;
+static bool acRestorePending = false;
+
+static void updateLocalRestorePolicy(const RestorePolicy& restorePolicy)
+{
+    if (localRestorePolicy &&
+        localRestorePolicy->policy == restorePolicy.policy &&
+        localRestorePolicy->delay == restorePolicy.delay &&
+        localRestorePolicy->acBootKnown == restorePolicy.acBootKnown)
+    {
+        return;
+    }
+    localRestorePolicy = restorePolicy;
+    writeFileAtomic(powerControlDir / restorePolicyFile,
+                    restorePolicy.policy + "\n" +
+                        std::to_string(restorePolicy.delay) + "\n" +
+                        std::to_string(restorePolicy.acBootKnown) + "\n");
+}
+
+static void powerRestorePolicyDelay(int delay);
+
+static void localRestorePolicyInit()
+{
+    std::ifstream restorePolicyStream(powerControlDir / restorePolicyFile);
+    RestorePolicy restorePolicy;
+    if (std::getline(restorePolicyStream, restorePolicy.policy) &&
+        restorePolicyStream >> restorePolicy.delay)
+    {
+        // Mirrors written before ACBoot was recorded don't have it
+        int acBootKnown = 1;
+        restorePolicyStream >> acBootKnown;
+        restorePolicy.acBootKnown = acBootKnown != 0;
+        localRestorePolicy = restorePolicy;
+    }
+
+    // Follow the settings for as long as the daemon runs
+    watchSetting(powerRestorePolicySetting, [](const SettingsValue& value) {
+        const std::string* policy = std::get_if<std::string>(&value);
+        if (policy != nullptr)
+        {
+            RestorePolicy restorePolicy =
+                localRestorePolicy.value_or(RestorePolicy());
+            restorePolicy.policy = *policy;
+            updateLocalRestorePolicy(restorePolicy);
+        }
+        return false;
+    });
+    watchSetting(powerRestoreDelaySetting, [](const SettingsValue& value) {
+        const uint16_t* delay = std::get_if<uint16_t>(&value);
+        if (delay != nullptr)
+        {
+            RestorePolicy restorePolicy =
+                localRestorePolicy.value_or(RestorePolicy());
+            restorePolicy.delay = *delay;
+            updateLocalRestorePolicy(restorePolicy);
+            // A delay started from the mirror follows the settings
+            if (restorePolicyFromMirror)
+            {
+                powerRestorePolicyDelay(*delay);
+            }
+        }
+        return false;
+    });
+}
+
+static uint64_t getBootTimeMs()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+static uint64_t getFirmwareBootTimeMs()
+{
+    if (!restoreDelayConfig.firmwareBootTimeFile.empty())
+    {
+        std::ifstream firmwareStream(restoreDelayConfig.firmwareBootTimeFile);
+        uint64_t firmwareMs = 0;
+        if (firmwareStream >> firmwareMs)
+        {
+            return firmwareMs;
+        }
+        std::cerr << "Failed to read the firmware boot time from "
+                  << restoreDelayConfig.firmwareBootTimeFile
+                  << ", using the configured time\n";
+    }
+    return restoreDelayConfig.firmwareBootTimeMs;
+}
+
+static void acRestoreObserver(const PowerState, const PowerState newState)
+{
+    if (!acRestorePending || newState != PowerState::on)
+    {
+        return;
+    }
+    acRestorePending = false;
+    acRestoreLatencyMs = restoreDelayBudget.firmwareMs + getBootTimeMs();
+    std::cerr << "Host powered on " << acRestoreLatencyMs
+              << "ms after AC on, restore policy started from "
+              << (acRestoreFromMirror ? "the local mirror" : "Settings")
+              << "\n";
+}
+
+static uint64_t getRestoreJitterMs()
+{
+    if (restoreStaggerConfig.windowMs == 0)
+    {
+        return 0;
+    }
+    std::ifstream identityStream(restoreStaggerConfig.identityFile);
+    std::string identity;
+    if (!std::getline(identityStream, identity) || identity.empty())
+    {
+        std::cerr << "Failed to read the board identity from "
+                  << restoreStaggerConfig.identityFile
+                  << ", restoring without jitter\n";
+        return 0;
+    }
+    boost::crc_32_type crc;
+    crc.process_bytes(identity.data(), identity.size());
+    return crc.checksum() % (uint64_t(restoreStaggerConfig.windowMs) + 1);
+}
+
+static void releasePowerToken()
+{
+    if (powerTokenFd < 0)
+    {
+        return;
+    }
+    ::close(powerTokenFd);
+    powerTokenFd = -1;
+    if (powerTokenHeld)
+    {
+        powerTokenHeld = false;
+        std::cerr << "Power token released\n";
+    }
+}
+
+// Returns false while another host holds the token.  A token file that
+// can't be opened doesn't hold up the power-on.
+static bool takePowerToken()
+{
+    if (powerTokenFd < 0)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(
+            restoreStaggerConfig.powerTokenFile.parent_path(), ec);
+        powerTokenFd =
+            ::open(restoreStaggerConfig.powerTokenFile.c_str(),
+                   O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (powerTokenFd < 0)
+        {
+            std::cerr << "failed to open "
+                      << restoreStaggerConfig.powerTokenFile << "\n";
+            return true;
+        }
+    }
+    if (::flock(powerTokenFd, LOCK_EX | LOCK_NB) < 0)
+    {
+        return false;
+    }
+    powerTokenHeld = true;
+    return true;
+}
+
+static void restorePowerOnNow(const RestartCause cause)
+{
+    restoreStaggerPending = false;
+    acRestorePending = true;
+    sendPowerControlEvent(Event::powerOnRequest);
+    setRestartCauseProperty(getRestartCause(cause));
+    // Nothing to wait for if the request didn't start a power-on
+    if (powerState != PowerState::waitForPSPowerOK &&
+        powerState != PowerState::waitForSIOPowerGood)
+    {
+        releasePowerToken();
+    }
+}
+
+static void waitForPowerToken(const RestartCause cause,
+                              const EventTime startTime)
+{
+    powerTokenWaitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - startTime)
+                           .count();
+    if (restoreStaggerConfig.powerTokenFile.empty() || takePowerToken())
+    {
+        restorePowerOnNow(cause);
+        return;
+    }
+    if (powerTokenWaitMs >= restoreStaggerConfig.powerTokenTimeoutMs)
+    {
+        std::cerr << "Timed out waiting for the power token, powering on "
+                     "without it\n";
+        releasePowerToken();
+        restorePowerOnNow(cause);
+        return;
+    }
+    restoreStaggerTimer.expires_after(
+        std::chrono::milliseconds(powerTokenPollMs));
+    restoreStaggerTimer.async_wait(
+        [cause, startTime](const boost::system::error_code ec) {
+            if (ec)
+            {
+                // operation_aborted is expected if timer is canceled before
+                // completion.
+                if (ec != boost::asio::error::operation_aborted)
+                {
+                    std::cerr << "Power token async_wait failed: "
+                              << ec.message() << "\n";
+                }
+                return;
+            }
+            waitForPowerToken(cause, startTime);
+        });
+}
+
+static void restorePowerOn(const RestartCause cause)
+{
+    restoreJitterMs = getRestoreJitterMs();
+    if (restoreJitterMs == 0 && restoreStaggerConfig.powerTokenFile.empty())
+    {
+        restorePowerOnNow(cause);
+        return;
+    }
+    std::cerr << "Restore power-on staggered by " << restoreJitterMs
+              << "ms\n";
+    restoreStaggerPending = true;
+    restoreStaggerTimer.expires_after(
+        std::chrono::milliseconds(restoreJitterMs));
+    restoreStaggerTimer.async_wait([cause](const boost::system::error_code ec) {
+        if (ec)
+        {
+            // operation_aborted is expected if timer is canceled before
+            // completion.
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                std::cerr << "Restore stagger async_wait failed: "
+                          << ec.message() << "\n";
+            }
+            return;
+        }
+        waitForPowerToken(cause, std::chrono::steady_clock::now());
+    });
+}
+
+static void cancelRestorePowerOn()
+{
+    if (!restoreStaggerPending)
+    {
+        return;
+    }
+    std::cerr << "Canceling the staggered restore power-on\n";
+    restoreStaggerPending = false;
+    restoreStaggerTimer.cancel();
+    releasePowerToken();
+}
+
+static void powerTokenObserver(const PowerState, const PowerState newState)
+{
+    if (powerTokenHeld && newState != PowerState::waitForPSPowerOK &&
+        newState != PowerState::waitForSIOPowerGood)
+    {
+        releasePowerToken();
+    }
+}
+
+static void invokePowerRestorePolicy(const std::string& policy)
+{
+    // Async events may call this twice, but we only want to run once
+    if (restorePolicyInvoked)
+    {
+        return;
+    }
+    restorePolicyInvoked = true;
+    acRestoreFromMirror = restorePolicyFromMirror;
+
+    std::cerr << "Power restore delay expired, invoking " << policy << "\n";
+    if (policy ==
+        "xyz.openbmc_project.Control.Power.RestorePolicy.Policy.AlwaysOn")
+    {
+        restorePowerOn(RestartCause::powerPolicyOn);
+    }
+    else if (policy == "xyz.openbmc_project.Control.Power.RestorePolicy."
+                       "Policy.Restore")
+    {
+        if (wasPowerDropped())
+        {
+            std::cerr << "Power was dropped, restoring Host On state\n";
+            restorePowerOn(RestartCause::powerPolicyRestore);
+        }
+        else
+        {
+            std::cerr << "No power drop, restoring Host Off state\n";
+        }
+    }
+    // We're done with the previous power state for the restore policy, so store
+    // the current state
+    savePowerState(powerState);
+}
+
+// A host found off with the state file saying on is only taken as an AC loss
+// once Settings confirms it with ACBoot, since a BMC-only reboot looks the
+// same from here.  If Settings doesn't answer within acBootWaitMs, the policy
+// runs from the mirror anyway.
+static void invokeMirrorRestorePolicy()
+{
+    if (acBootReported)
+    {
+        // The mirror follows the policy setting once Settings is up
+        invokePowerRestorePolicy(localRestorePolicy->policy);
+        return;
+    }
+    std::cerr << "Power restore delay expired, waiting up to "
+              << restoreDelayConfig.acBootWaitMs << "ms for ACBoot\n";
+    acBootWaitTimer.expires_after(
+        std::chrono::milliseconds(restoreDelayConfig.acBootWaitMs));
+    acBootWaitTimer.async_wait([](const boost::system::error_code ec) {
+        if (ec)
+        {
+            // operation_aborted is expected if timer is canceled before
+            // completion.
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                std::cerr << "ACBoot wait async_wait failed: " << ec.message()
+                          << "\n";
+            }
+            return;
+        }
+        std::cerr << "Settings did not report ACBoot, invoking the power "
+                     "restore policy from the local mirror\n";
+        invokePowerRestorePolicy(localRestorePolicy->policy);
+    });
+}
+
+static void powerRestorePolicyDelay(int delay)
+{
+    // Async events may call this twice, but we only want to run once for
+    // each delay.  A new delay re-arms the timer until it has expired.
+    if (restorePolicyInvoked || restoreDelayExpired ||
+        powerRestorePolicyTimerDelay == delay)
+    {
+        return;
+    }
+    powerRestorePolicyTimerDelay = delay;
+    // Calculate the delay from now to meet the requested delay by
+    // subtracting the firmware boot time and the time since the kernel
+    // started, suspend included
+    restoreDelayBudget.firmwareMs = getFirmwareBootTimeMs();
+    restoreDelayBudget.bootTimeMs = getBootTimeMs();
+    uint64_t delayMs = static_cast<uint64_t>(delay) * 1000;
+    uint64_t elapsedMs =
+        restoreDelayBudget.firmwareMs + restoreDelayBudget.bootTimeMs;
+    // 0 is the minimum delay
+    restoreDelayBudget.timerMs = delayMs > elapsedMs ? delayMs - elapsedMs : 0;
+
+    powerRestorePolicyTimer.expires_after(
+        std::chrono::milliseconds(restoreDelayBudget.timerMs));
+    std::cerr << "Power restore delay of " << delay << "s started, "
+              << restoreDelayBudget.firmwareMs << "ms firmware and "
+              << restoreDelayBudget.bootTimeMs << "ms since boot elapsed, "
+              << restoreDelayBudget.timerMs << "ms remaining\n";
+    powerRestorePolicyTimer.async_wait([](const boost::system::error_code ec) {
+        if (ec)
+        {
+            // operation_aborted is expected if timer is canceled before
+            // completion.
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                std::cerr << "power restore policy async_wait failed: "
+                          << ec.message() << "\n";
+            }
+            return;
+        }
+        restoreDelayExpired = true;
+        if (restorePolicyFromMirror)
+        {
+            invokeMirrorRestorePolicy();
+            return;
+        }
+        // Get Power Restore Policy, waiting for it if it is not available yet
+        watchSetting(powerRestorePolicySetting,
+                     [](const SettingsValue& property) {
+                         const std::string* policy =
+                             std::get_if<std::string>(&property);
+                         if (policy == nullptr)
+                         {
+                             std::cerr << "Unable to read power restore "
+                                          "policy value\n";
+                             return true;
+                         }
+                         invokePowerRestorePolicy(*policy);
+                         return true;
+                     });
+    });
+}
+
+static void powerRestorePolicyStart()
+{
+    if (restorePolicyFromMirror)
+    {
+        // Already started from the mirror, and now free to run
+        acBootReported = true;
+        if (acBootWaitTimer.cancel() > 0)
+        {
+            invokePowerRestorePolicy(localRestorePolicy->policy);
+        }
+        return;
+    }
+    std::cerr << "Power restore policy started\n";
+    powerRestorePolicyLog();
+
+    // Get the desired delay time, waiting for it if it is not available yet
+    watchSetting(powerRestoreDelaySetting, [](const SettingsValue& property) {
+        const uint16_t* delay = std::get_if<uint16_t>(&property);
+        if (delay == nullptr)
+        {
+            std::cerr << "Unable to read power restore delay value\n";
+            return true;
+        }
+        powerRestorePolicyDelay(*delay);
+        return true;
+    });
+}
+
+// Settings says this was not an AC boot, so a policy started from the
+// mirror is stopped if it has not run yet or its power-on is still staggered
+static void powerRestorePolicyCancel()
+{
+    if (!restorePolicyFromMirror)
+    {
+        return;
+    }
+    if (restoreStaggerPending)
+    {
+        std::cerr << "Settings reports no AC boot, canceling the power restore "
+                     "policy power-on started from the local mirror\n";
+        cancelRestorePowerOn();
+        return;
+    }
+    if (restorePolicyInvoked)
+    {
+        std::cerr << "Settings reports no AC boot, but the power restore "
+                     "policy already ran from the local mirror\n";
+        return;
+    }
+    std::cerr << "Settings reports no AC boot, canceling the power restore "
+                 "policy started from the local mirror\n";
+    restorePolicyInvoked = true;
+    powerRestorePolicyTimer.cancel();
+    acBootWaitTimer.cancel();
+}
+
+static void powerRestorePolicyCheck()
+{
+    // Wait for ACBoot to be known
+    watchSetting(acBootSetting, [](const SettingsValue& property) {
+        const std::string* acBoot = std::get_if<std::string>(&property);
+        if (acBoot == nullptr)
+        {
+            std::cerr << "Unable to read AC Boot status\n";
+            return true;
+        }
+        if (*acBoot == "Unknown")
+        {
+            return false;
+        }
+        if (localRestorePolicy && !localRestorePolicy->acBootKnown)
+        {
+            RestorePolicy restorePolicy = *localRestorePolicy;
+            restorePolicy.acBootKnown = true;
+            updateLocalRestorePolicy(restorePolicy);
+        }
+        if (*acBoot == "True")
+        {
+            // Start the Power Restore policy
+            powerRestorePolicyStart();
+        }
+        else
+        {
+            powerRestorePolicyCancel();
+        }
+        return true;
+    });
+}
+
+// Start the policy delay from the mirror without waiting for Settings.  ACBoot
+// is not known yet, so only a host that was on before and is now off is taken
+// as a possible AC loss, to be confirmed before the policy runs.
+static void powerRestorePolicyLocalCheck()
+{
+    addPowerStateObserver(acRestoreObserver);
+    addPowerStateObserver(powerTokenObserver);
+    if (!localRestorePolicy || localRestorePolicy->policy.empty() ||
+        !localRestorePolicy->acBootKnown)
+    {
+        std::cerr << "No local power restore policy, waiting for Settings\n";
+        return;
+    }
+    if (!wasPowerDropped() ||
+        getChassisState(powerState) !=
+            "xyz.openbmc_project.State.Chassis.PowerState.Off")
+    {
+        return;
+    }
+    std::cerr << "Power restore policy started from the local mirror\n";
+    powerRestorePolicyLog();
+    restorePolicyFromMirror = true;
+    powerRestorePolicyDelay(localRestorePolicy->delay);
 }
-static void addRestartCause(const RestartCause cause)
-{
-    // Add this to the set of causes for this restart
-    causeSet.insert(cause);
-}
-static void clearRestartCause()
+
+// GPIO line mapping.  Line values are requested with the configured polarity
+// so that, for every line, 1 (and a rising edge) means the signal is asserted.
+struct GPIOConfig
 {
-    // Clear the set for the next restart
-    causeSet.clear();
-}
-static void setRestartCauseProperty(const std::string& cause)
+    // The line is found either by name or by chip and offset
+    std::string lineName;
+    std::string chipName;
+    int lineOffset = -1;
+    bool activeLow = false;
+    // Optional lines may be absent without failing startup
+    bool optional = false;
+    // Edge-storm threshold for this line, 0 to use the global threshold
+    uint32_t maxEdgesPerSecond = 0;
+    gpiod::line line;
+};
+static boost::container::flat_map<std::string, GPIOConfig> gpioConfigs = {
+    {psPowerOKName, {psPowerOKName, "", -1, false, false, 0, {}}},
+    {sioPowerGoodName, {sioPowerGoodName, "", -1, false, false, 0, {}}},
+    {sioOnControlName, {sioOnControlName, "", -1, false, true, 0, {}}},
+    {sioS5Name, {sioS5Name, "", -1, true, false, 0, {}}},
+    {powerButtonName, {powerButtonName, "", -1, true, false, 0, {}}},
+    {resetButtonName, {resetButtonName, "", -1, true, false, 0, {}}},
+    {nmiButtonName, {nmiButtonName, "", -1, true, true, 0, {}}},
+    {idButtonName, {idButtonName, "", -1, true, true, 0, {}}},
+    {postCompleteName, {postCompleteName, "", -1, true, false, 0, {}}},
+    {powerOutName, {powerOutName, "", -1, true, false, 0, {}}},
+    {resetOutName, {resetOutName, "", -1, true, false, 0, {}}},
+    {nmiOutName, {nmiOutName, "", -1, false, false, 0, {}}},
+};
+
+// Edge-storm thresholds
+struct EdgeStormConfig
 {
-    std::cerr << "RestartCause set to " << cause << "\n";
-    restartCauseIface->set_property("RestartCause", cause);
-}
-static void setRestartCause()
+    uint32_t maxEdgesPerSecond = 100;
+    uint32_t sampleIntervalMs = 100;
+};
+static EdgeStormConfig edgeStormConfig;
+
+static void loadPowerConfig()
 {
-    // Determine the actual restart cause based on the set of causes
-    std::string restartCause =
-        "xyz.openbmc_project.State.Host.RestartCause.Unknown";
-    if (causeSet.contains(RestartCause::watchdog))
+    std::ifstream configStream(powerConfigFile);
+    if (!configStream.is_open())
     {
-        restartCause = getRestartCause(RestartCause::watchdog);
+        std::cerr << "No power config at " << powerConfigFile
+                  << ", using default GPIO line names\n";
+        return;
     }
-    else if (causeSet.contains(RestartCause::command))
+    nlohmann::json config = nlohmann::json::parse(configStream, nullptr, false);
+    if (config.is_discarded() || !config.is_object())
     {
-        restartCause = getRestartCause(RestartCause::command);
+        std::cerr << "Failed to parse " << powerConfigFile
+                  << ", using default GPIO line names\n";
+        return;
     }
-    else if (causeSet.contains(RestartCause::resetButton))
+    if (config.contains("EdgeStorm"))
     {
-        restartCause = getRestartCause(RestartCause::resetButton);
+        try
+        {
+            const nlohmann::json& edgeStorm = config["EdgeStorm"];
+            edgeStormConfig.maxEdgesPerSecond = edgeStorm.value(
+                "MaxEdgesPerSecond", edgeStormConfig.maxEdgesPerSecond);
+            edgeStormConfig.sampleIntervalMs = std::max(
+                edgeStorm.value("SampleIntervalMs",
+                                edgeStormConfig.sampleIntervalMs),
+                uint32_t(1));
+        }
+        catch (nlohmann::json::exception& e)
+        {
+            std::cerr << "Invalid edge storm config\n";
+        }
     }
-    else if (causeSet.contains(RestartCause::powerButton))
+    if (config.contains("RestoreDelay"))
     {
-        restartCause = getRestartCause(RestartCause::powerButton);
+        try
+        {
+            const nlohmann::json& restoreDelay = config["RestoreDelay"];
+            restoreDelayConfig.firmwareBootTimeMs =
+                restoreDelay.value("FirmwareBootTimeMs",
+                                   restoreDelayConfig.firmwareBootTimeMs);
+            restoreDelayConfig.firmwareBootTimeFile =
+                restoreDelay.value("FirmwareBootTimeFile", std::string());
+            restoreDelayConfig.acBootWaitMs = restoreDelay.value(
+                "ACBootWaitMs", restoreDelayConfig.acBootWaitMs);
+        }
+        catch (nlohmann::json::exception& e)
+        {
+            std::cerr << "Invalid restore delay config\n";
+        }
     }
-    else if (causeSet.contains(RestartCause::powerPolicyOn))
+    if (config.contains("RestoreStagger"))
     {
-        restartCause = getRestartCause(RestartCause::powerPolicyOn);
+        try
+        {
+            const nlohmann::json& restoreStagger = config["RestoreStagger"];
+            restoreStaggerConfig.windowMs = restoreStagger.value(
+                "StaggerWindowMs", restoreStaggerConfig.windowMs);
+            restoreStaggerConfig.identityFile = restoreStagger.value(
+                "IdentityFile", restoreStaggerConfig.identityFile.string());
+            restoreStaggerConfig.powerTokenFile =
+                restoreStagger.value("PowerTokenFile", std::string());
+            restoreStaggerConfig.powerTokenTimeoutMs =
+                restoreStagger.value("PowerTokenTimeoutMs",
+                                     restoreStaggerConfig.powerTokenTimeoutMs);
+        }
+        catch (nlohmann::json::exception& e)
+        {
+            std::cerr << "Invalid restore stagger config\n";
+        }
     }
-    else if (causeSet.contains(RestartCause::powerPolicyRestore))
+    if (!config.contains("GPIOs"))
     {
-        restartCause = getRestartCause(RestartCause::powerPolicyRestore);
+        return;
     }
-    else if (causeSet.contains(RestartCause::softReset))
+
+    for (auto& [role, lineConfig] : config["GPIOs"].items())
     {
-        restartCause = getRestartCause(RestartCause::softReset);
+        auto it = gpioConfigs.find(role);
+        if (it == gpioConfigs.end())
+        {
+            std::cerr << "Ignoring unknown GPIO role " << role << "\n";
+            continue;
+        }
+        GPIOConfig& gpioConfig = it->second;
+        try
+        {
+            if (lineConfig.contains("ChipName"))
+            {
+                gpioConfig.chipName = lineConfig["ChipName"].get<std::string>();
+                gpioConfig.lineOffset = lineConfig["LineOffset"].get<int>();
+                gpioConfig.lineName.clear();
+            }
+            else if (lineConfig.contains("LineName"))
+            {
+                gpioConfig.lineName = lineConfig["LineName"].get<std::string>();
+            }
+            if (lineConfig.contains("Polarity"))
+            {
+                gpioConfig.activeLow =
+                    lineConfig["Polarity"].get<std::string>() == "ActiveLow";
+            }
+            if (lineConfig.contains("Optional"))
+            {
+                gpioConfig.optional = lineConfig["Optional"].get<bool>();
+            }
+            if (lineConfig.contains("MaxEdgesPerSecond"))
+            {
+                gpioConfig.maxEdgesPerSecond =
+                    lineConfig["MaxEdgesPerSecond"].get<uint32_t>();
+            }
+        }
+        catch (nlohmann::json::exception& e)
+        {
+            std::cerr << "Invalid config for GPIO role " << role << "\n";
+        }
     }
-
-    setRestartCauseProperty(restartCause);
 }
 
-static void systemPowerGoodFailedLog()
+static bool resolveGPIOLines()
 {
-    sd_journal_send(
-        "MESSAGE=PowerControl: system power good failed to assert (VR failure)",
-        "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-        "OpenBMC.0.1.SystemPowerGoodFailed", "REDFISH_MESSAGE_ARGS=%d",
-        sioPowerGoodWatchdogTimeMs, NULL);
+    // Lines given by chip and offset are opened directly.  The rest are found
+    // by name in a single pass over all chips, rather than one full scan of
+    // every chip per line.
+    boost::container::flat_map<std::string, std::vector<GPIOConfig*>>
+        unresolved;
+    for (auto& [role, gpioConfig] : gpioConfigs)
+    {
+        if (gpioConfig.lineName.empty())
+        {
+            try
+            {
+                gpiod::chip chip(gpioConfig.chipName);
+                gpioConfig.line = chip.get_line(gpioConfig.lineOffset);
+            }
+            catch (std::exception&)
+            {
+                std::cerr << "Failed to open " << gpioConfig.chipName
+                          << " line " << gpioConfig.lineOffset << "\n";
+            }
+            continue;
+        }
+        unresolved[gpioConfig.lineName].push_back(&gpioConfig);
+    }
+
+    for (auto& chip : gpiod::make_chip_iter())
+    {
+        for (auto& line : gpiod::line_iter(chip))
+        {
+            auto it = unresolved.find(line.name());
+            if (it == unresolved.end())
+            {
+                continue;
+            }
+            for (GPIOConfig* gpioConfig : it->second)
+            {
+                gpioConfig->line = line;
+            }
+            unresolved.erase(it);
+            if (unresolved.empty())
+            {
+                break;
+            }
+        }
+        if (unresolved.empty())
+        {
+            break;
+        }
+    }
+
+    bool resolved = true;
+    for (const auto& [role, gpioConfig] : gpioConfigs)
+    {
+        if (gpioConfig.line)
+        {
+            continue;
+        }
+        if (gpioConfig.optional)
+        {
+            std::cerr << "Optional " << role << " line not found\n";
+            continue;
+        }
+        std::cerr << "Failed to find the " << role << " line\n";
+        resolved = false;
+    }
+    return resolved;
 }
 
-static void psPowerOKFailedLog()
+static std::bitset<32> getGPIORequestFlags(const GPIOConfig& gpioConfig)
 {
-    sd_journal_send(
-        "MESSAGE=PowerControl: power supply power good failed to assert",
-        "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-        "OpenBMC.0.1.PowerSupplyPowerGoodFailed", "REDFISH_MESSAGE_ARGS=%d",
-        psPowerOKWatchdogTimeMs, NULL);
+    return gpioConfig.activeLow ? gpiod::line_request::FLAG_ACTIVE_LOW
+                                : std::bitset<32>();
 }
 
-static void powerRestorePolicyLog()
+// GPIO event monitoring with edge-storm protection.  A line that toggles
+// faster than its configured limit is masked: it is re-requested as a plain
+// input, so the kernel stops queueing its edges, and its level is sampled at
+// a fixed interval.  Only a change in the sampled level is passed to the
+// handler.  Once a second the line's edges are requested again for one
+// sample interval and counted as they arrive, and the line is unmasked once
+// they have slowed below the limit.
+struct GPIOEventMonitor
 {
-    sd_journal_send("MESSAGE=PowerControl: power restore policy applied",
-                    "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-                    "OpenBMC.0.1.PowerRestorePolicyApplied", NULL);
-}
+    GPIOEventMonitor(const std::string& name, gpiod::line& line,
+                     boost::asio::posix::stream_descriptor& event,
+                     const std::function<void(const gpiod::line_event&)>&
+                         handler,
+                     const std::bitset<32> requestFlags,
+                     const uint32_t maxEdgesPerSecond) :
+        name(name),
+        line(line), event(event), handler(handler),
+        requestFlags(requestFlags), maxEdgesPerSecond(maxEdgesPerSecond),
+        sampleTimer(io)
+    {
+    }
+    std::string name;
+    gpiod::line& line;
+    boost::asio::posix::stream_descriptor& event;
+    std::function<void(const gpiod::line_event&)> handler;
+    std::bitset<32> requestFlags;
+    uint32_t maxEdgesPerSecond;
+    // Edges seen in the current one second window
+    EventTime windowStart;
+    uint32_t windowEdges = 0;
+    // Edge type last passed to the handler
+    int lastEdge = 0;
+    bool masked = false;
+    // Time the line is sampled while masked
+    boost::asio::steady_timer sampleTimer;
+    // Samples since the last probe, and edges counted by the current probe
+    uint32_t samples = 0;
+    bool probing = false;
+    uint32_t probeEdges = 0;
+    uint64_t suppressedEdges = 0;
+    uint32_t edgeStorms = 0;
+};
+static boost::container::flat_map<std::string,
+                                  std::unique_ptr<GPIOEventMonitor>>
+    gpioEventMonitors;
+static constexpr uint32_t edgeStormProbeIntervalMs = 1000;
 
-static void powerButtonPressLog()
+static void edgeStormLog(const GPIOEventMonitor& monitor)
 {
-    sd_journal_send("MESSAGE=PowerControl: power button pressed", "PRIORITY=%i",
-                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-                    "OpenBMC.0.1.PowerButtonPressed", NULL);
+    sd_journal_send("MESSAGE=PowerControl: %s edge storm, line masked",
+                    monitor.name.c_str(), "PRIORITY=%i", LOG_WARNING,
+                    "REDFISH_MESSAGE_ID=%s", "OpenBMC.0.1.GPIOEdgeStorm",
+                    "REDFISH_MESSAGE_ARGS=%s,%u", monitor.name.c_str(),
+                    monitor.maxEdgesPerSecond, NULL);
 }
 
-static void resetButtonPressLog()
+static void dispatchGPIOEvent(GPIOEventMonitor& monitor,
+                              const gpiod::line_event& gpioLineEvent)
 {
-    sd_journal_send("MESSAGE=PowerControl: reset button pressed", "PRIORITY=%i",
-                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-                    "OpenBMC.0.1.ResetButtonPressed", NULL);
+    monitor.lastEdge = gpioLineEvent.event_type;
+    monitor.handler(gpioLineEvent);
 }
 
-static void nmiButtonPressLog()
+static int getGPIOLevelEdge(const GPIOEventMonitor& monitor)
 {
-    sd_journal_send("MESSAGE=PowerControl: NMI button pressed", "PRIORITY=%i",
-                    LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-                    "OpenBMC.0.1.NMIButtonPressed", NULL);
+    return monitor.line.get_value() ? gpiod::line_event::RISING_EDGE
+                                    : gpiod::line_event::FALLING_EDGE;
 }
 
-static void nmiDiagIntLog()
+// Passes a change in the line's level to the handler as an edge
+static void dispatchGPIOLevel(GPIOEventMonitor& monitor)
 {
-    sd_journal_send("MESSAGE=PowerControl: NMI Diagnostic Interrupt",
-                    "PRIORITY=%i", LOG_INFO, "REDFISH_MESSAGE_ID=%s",
-                    "OpenBMC.0.1.NMIDiagnosticInterrupt", NULL);
+    int edge = getGPIOLevelEdge(monitor);
+    if (edge == monitor.lastEdge)
+    {
+        return;
+    }
+    gpiod::line_event gpioLineEvent{
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()),
+        edge, monitor.line};
+    dispatchGPIOEvent(monitor, gpioLineEvent);
 }
 
-static int initializePowerStateStorage()
+static bool requestGPIOLine(GPIOEventMonitor& monitor, const int requestType)
 {
-    // create the power control directory if it doesn't exist
-    std::error_code ec;
-    if (!(std::filesystem::create_directories(powerControlDir, ec)))
+    try
     {
-        if (ec.value() != 0)
-        {
-            std::cerr << "failed to create " << powerControlDir << ": "
-                      << ec.message() << "\n";
-            return -1;
-        }
+        monitor.line.request(
+            {"power-control", requestType, monitor.requestFlags});
     }
-    // Create the power state file if it doesn't exist
-    if (!std::filesystem::exists(powerControlDir / powerStateFile))
+    catch (std::exception&)
     {
-        std::ofstream powerStateStream(powerControlDir / powerStateFile);
-        powerStateStream << getChassisState(powerState);
+        std::cerr << "Failed to re-request " << monitor.name << "\n";
+        return false;
     }
-    return 0;
+    if (requestType == gpiod::line_request::EVENT_BOTH_EDGES)
+    {
+        monitor.event.assign(monitor.line.event_get_fd());
+    }
+    return true;
 }
 
-static bool wasPowerDropped()
+// Stops the kernel queueing edges for the line, keeping it as an input
+static bool maskGPIOLine(GPIOEventMonitor& monitor)
 {
-    std::ifstream powerStateStream(powerControlDir / powerStateFile);
-    if (!powerStateStream.is_open())
+    // The line owns the event fd, so the descriptor lets go of it without
+    // closing it.  This cancels any wait on it.
+    monitor.event.release();
+    monitor.line.release();
+    monitor.samples = 0;
+    return requestGPIOLine(monitor, gpiod::line_request::DIRECTION_INPUT);
+}
+
+static uint32_t readGPIOEdges(GPIOEventMonitor& monitor)
+{
+    uint32_t edges = 0;
+    while (monitor.line.event_wait(std::chrono::nanoseconds(0)))
     {
-        std::cerr << "Failed to open power state file\n";
-        return false;
+        edges += monitor.line.event_read_multiple().size();
     }
+    return edges;
+}
 
-    std::string state;
-    std::getline(powerStateStream, state);
-    return state == "xyz.openbmc_project.State.Chassis.PowerState.On";
+static void countProbeEdges(GPIOEventMonitor& monitor)
+{
+    monitor.event.async_wait(
+        boost::asio::posix::stream_descriptor::wait_read,
+        [&monitor](const boost::system::error_code ec) {
+            if (ec)
+            {
+                // operation_aborted is expected when the probe ends
+                return;
+            }
+            monitor.probeEdges += readGPIOEdges(monitor);
+            countProbeEdges(monitor);
+        });
 }
 
-static void invokePowerRestorePolicy(const std::string& policy)
+static void waitForGPIOEvent(GPIOEventMonitor& monitor);
+static void sampleGPIOLine(GPIOEventMonitor& monitor);
+
+static void startGPIOProbe(GPIOEventMonitor& monitor)
 {
-    // Async events may call this twice, but we only want to run once
-    static bool policyInvoked = false;
-    if (policyInvoked)
+    monitor.line.release();
+    if (!requestGPIOLine(monitor, gpiod::line_request::EVENT_BOTH_EDGES))
     {
         return;
     }
-    policyInvoked = true;
+    monitor.probing = true;
+    monitor.probeEdges = 0;
+    countProbeEdges(monitor);
+    sampleGPIOLine(monitor);
+}
 
-    std::cerr << "Power restore delay expired, invoking " << policy << "\n";
-    if (policy ==
-        "xyz.openbmc_project.Control.Power.RestorePolicy.Policy.AlwaysOn")
-    {
-        sendPowerControlEvent(Event::powerOnRequest);
-        setRestartCauseProperty(getRestartCause(RestartCause::powerPolicyOn));
-    }
-    else if (policy == "xyz.openbmc_project.Control.Power.RestorePolicy."
-                       "Policy.Restore")
+static void endGPIOProbe(GPIOEventMonitor& monitor)
+{
+    monitor.probing = false;
+    monitor.event.cancel();
+    monitor.probeEdges += readGPIOEdges(monitor);
+    monitor.suppressedEdges += monitor.probeEdges;
+    dispatchGPIOLevel(monitor);
+
+    uint64_t edgesPerSecond =
+        uint64_t(monitor.probeEdges) * 1000 / edgeStormConfig.sampleIntervalMs;
+    if (edgesPerSecond > monitor.maxEdgesPerSecond)
     {
-        if (wasPowerDropped())
-        {
-            std::cerr << "Power was dropped, restoring Host On state\n";
-            sendPowerControlEvent(Event::powerOnRequest);
-            setRestartCauseProperty(
-                getRestartCause(RestartCause::powerPolicyRestore));
-        }
-        else
+        if (maskGPIOLine(monitor))
         {
-            std::cerr << "No power drop, restoring Host Off state\n";
+            sampleGPIOLine(monitor);
         }
+        return;
     }
-    // We're done with the previous power state for the restore policy, so store
-    // the current state
-    savePowerState(powerState);
+    std::cerr << monitor.name << " edge storm ended, "
+              << monitor.suppressedEdges << " edges suppressed in total\n";
+    monitor.masked = false;
+    monitor.windowEdges = 0;
+    monitor.windowStart = std::chrono::steady_clock::now();
+    waitForGPIOEvent(monitor);
 }
 
-static void powerRestorePolicyDelay(int delay)
+static void sampleGPIOLine(GPIOEventMonitor& monitor)
 {
-    // Async events may call this twice, but we only want to run once
-    static bool delayStarted = false;
-    if (delayStarted)
-    {
-        return;
-    }
-    delayStarted = true;
-    // Calculate the delay from now to meet the requested delay
-    // Subtract the approximate uboot time
-    static constexpr const int ubootSeconds = 20;
-    delay -= ubootSeconds;
-    // Subtract the time since boot
-    struct sysinfo info = {};
-    if (sysinfo(&info) == 0)
-    {
-        delay -= info.uptime;
-    }
-    // 0 is the minimum delay
-    delay = std::max(delay, 0);
-
-    static boost::asio::steady_timer powerRestorePolicyTimer(io);
-    powerRestorePolicyTimer.expires_after(std::chrono::seconds(delay));
-    std::cerr << "Power restore delay of " << delay << " seconds started\n";
-    powerRestorePolicyTimer.async_wait([](const boost::system::error_code ec) {
+    monitor.sampleTimer.expires_after(
+        std::chrono::milliseconds(edgeStormConfig.sampleIntervalMs));
+    monitor.sampleTimer.async_wait([&monitor](
+                                       const boost::system::error_code ec) {
         if (ec)
         {
             // operation_aborted is expected if timer is canceled before
             // completion.
             if (ec != boost::asio::error::operation_aborted)
             {
-                std::cerr << "power restore policy async_wait failed: "
-                          << ec.message() << "\n";
+                std::cerr << monitor.name
+                          << " sample async_wait failed: " << ec.message()
+                          << "\n";
             }
             return;
         }
-        // Get Power Restore Policy
-        // In case PowerRestorePolicy is not available, set a match for it
-        static std::unique_ptr<sdbusplus::bus::match::match>
-            powerRestorePolicyMatch = std::make_unique<
-                sdbusplus::bus::match::match>(
-                *conn,
-                "type='signal',interface='org.freedesktop.DBus.Properties',"
-                "member='PropertiesChanged',arg0namespace='xyz.openbmc_"
-                "project.Control.Power.RestorePolicy'",
-                [](sdbusplus::message::message& msg) {
-                    std::string interfaceName;
-                    boost::container::flat_map<std::string,
-                                               std::variant<std::string>>
-                        propertiesChanged;
-                    std::string policy;
-                    try
-                    {
-                        msg.read(interfaceName, propertiesChanged);
-                        policy = std::get<std::string>(
-                            propertiesChanged.begin()->second);
-                    }
-                    catch (std::exception& e)
-                    {
-                        std::cerr
-                            << "Unable to read power restore policy value\n";
-                        powerRestorePolicyMatch.reset();
-                        return;
-                    }
-                    invokePowerRestorePolicy(policy);
-                    powerRestorePolicyMatch.reset();
-                });
-
-        // Check if it's already on DBus
-        conn->async_method_call(
-            [](boost::system::error_code ec,
-               const std::variant<std::string>& policyProperty) {
-                if (ec)
-                {
-                    return;
-                }
-                powerRestorePolicyMatch.reset();
-                const std::string* policy =
-                    std::get_if<std::string>(&policyProperty);
-                if (policy == nullptr)
-                {
-                    std::cerr << "Unable to read power restore policy value\n";
-                    return;
-                }
-                invokePowerRestorePolicy(*policy);
-            },
-            "xyz.openbmc_project.Settings",
-            "/xyz/openbmc_project/control/host0/power_restore_policy",
-            "org.freedesktop.DBus.Properties", "Get",
-            "xyz.openbmc_project.Control.Power.RestorePolicy",
-            "PowerRestorePolicy");
+        if (monitor.probing)
+        {
+            endGPIOProbe(monitor);
+            return;
+        }
+        dispatchGPIOLevel(monitor);
+        if (++monitor.samples * edgeStormConfig.sampleIntervalMs >=
+            edgeStormProbeIntervalMs)
+        {
+            startGPIOProbe(monitor);
+            return;
+        }
+        sampleGPIOLine(monitor);
     });
 }
 
-static void powerRestorePolicyStart()
+// Returns false if the edge starts a storm and the line has been masked
+static bool countGPIOEdge(GPIOEventMonitor& monitor, const EventTime time)
 {
-    std::cerr << "Power restore policy started\n";
-    powerRestorePolicyLog();
-
-    // Get the desired delay time
-    // In case PowerRestoreDelay is not available, set a match for it
-    static std::unique_ptr<sdbusplus::bus::match::match>
-        powerRestoreDelayMatch = std::make_unique<sdbusplus::bus::match::match>(
-            *conn,
-            "type='signal',interface='org.freedesktop.DBus.Properties',member='"
-            "PropertiesChanged',arg0namespace='xyz.openbmc_project.Control."
-            "Power.RestoreDelay'",
-            [](sdbusplus::message::message& msg) {
-                std::string interfaceName;
-                boost::container::flat_map<std::string, std::variant<uint16_t>>
-                    propertiesChanged;
-                int delay = 0;
-                try
-                {
-                    msg.read(interfaceName, propertiesChanged);
-                    delay =
-                        std::get<uint16_t>(propertiesChanged.begin()->second);
-                }
-                catch (std::exception& e)
-                {
-                    std::cerr << "Unable to read power restore delay value\n";
-                    powerRestoreDelayMatch.reset();
-                    return;
-                }
-                powerRestorePolicyDelay(delay);
-                powerRestoreDelayMatch.reset();
-            });
-
-    // Check if it's already on DBus
-    conn->async_method_call(
-        [](boost::system::error_code ec,
-           const std::variant<uint16_t>& delayProperty) {
-            if (ec)
-            {
-                return;
-            }
-            powerRestoreDelayMatch.reset();
-            const uint16_t* delay = std::get_if<uint16_t>(&delayProperty);
-            if (delay == nullptr)
-            {
-                std::cerr << "Unable to read power restore delay value\n";
-                return;
-            }
-            powerRestorePolicyDelay(*delay);
-        },
-        "xyz.openbmc_project.Settings",
-        "/xyz/openbmc_project/control/power_restore_delay",
-        "org.freedesktop.DBus.Properties", "Get",
-        "xyz.openbmc_project.Control.Power.RestoreDelay", "PowerRestoreDelay");
+    if (time - monitor.windowStart >= std::chrono::seconds(1))
+    {
+        monitor.windowStart = time;
+        monitor.windowEdges = 0;
+    }
+    if (++monitor.windowEdges <= monitor.maxEdgesPerSecond)
+    {
+        return true;
+    }
+
+    // Log once per storm, rather than once per edge
+    monitor.masked = true;
+    monitor.edgeStorms++;
+    monitor.suppressedEdges++;
+    std::cerr << monitor.name << " exceeded " << monitor.maxEdgesPerSecond
+              << " edges per second, sampling every "
+              << edgeStormConfig.sampleIntervalMs << "ms\n";
+    edgeStormLog(monitor);
+    if (maskGPIOLine(monitor))
+    {
+        sampleGPIOLine(monitor);
+    }
+    return false;
 }
 
-static void powerRestorePolicyCheck()
+static void waitForGPIOEvent(GPIOEventMonitor& monitor)
 {
-    // In case ACBoot is not available, set a match for it
-    static std::unique_ptr<sdbusplus::bus::match::match> acBootMatch =
-        std::make_unique<sdbusplus::bus::match::match>(
-            *conn,
-            "type='signal',interface='org.freedesktop.DBus.Properties',member='"
-            "PropertiesChanged',arg0namespace='xyz.openbmc_project.Common."
-            "ACBoot'",
-            [](sdbusplus::message::message& msg) {
-                std::string interfaceName;
-                boost::container::flat_map<std::string,
-                                           std::variant<std::string>>
-                    propertiesChanged;
-                std::string acBoot;
-                try
-                {
-                    msg.read(interfaceName, propertiesChanged);
-                    acBoot = std::get<std::string>(
-                        propertiesChanged.begin()->second);
-                }
-                catch (std::exception& e)
-                {
-                    std::cerr << "Unable to read AC Boot status\n";
-                    acBootMatch.reset();
-                    return;
-                }
-                if (acBoot == "Unknown")
-                {
-                    return;
-                }
-                if (acBoot == "True")
-                {
-                    // Start the Power Restore policy
-                    powerRestorePolicyStart();
-                }
-                acBootMatch.reset();
-            });
-
-    // Check if it's already on DBus
-    conn->async_method_call(
-        [](boost::system::error_code ec,
-           const std::variant<std::string>& acBootProperty) {
+    monitor.event.async_wait(
+        boost::asio::posix::stream_descriptor::wait_read,
+        [&monitor](const boost::system::error_code ec) {
             if (ec)
             {
+                std::cerr << monitor.name
+                          << " fd handler error: " << ec.message() << "\n";
+                // TODO: throw here to force power-control to restart?
                 return;
             }
-            const std::string* acBoot =
-                std::get_if<std::string>(&acBootProperty);
-            if (acBoot == nullptr)
-            {
-                std::cerr << "Unable to read AC Boot status\n";
-                return;
-            }
-            if (*acBoot == "Unknown")
+            gpiod::line_event gpioLineEvent = monitor.line.event_read();
+            if (!countGPIOEdge(monitor, getGPIOEventTime(gpioLineEvent)))
             {
+                // The line is masked, so sampling takes over from here
                 return;
             }
-            if (*acBoot == "True")
-            {
-                // Start the Power Restore policy
-                powerRestorePolicyStart();
-            }
-            acBootMatch.reset();
-        },
-        "xyz.openbmc_project.Settings",
-        "/xyz/openbmc_project/control/host0/ac_boot",
-        "org.freedesktop.DBus.Properties", "Get",
-        "xyz.openbmc_project.Common.ACBoot", "ACBoot");
+            dispatchGPIOEvent(monitor, gpioLineEvent);
+            waitForGPIOEvent(monitor);
+        });
+}
+
+using EdgeCounts = boost::container::flat_map<std::string, uint64_t>;
+static EdgeCounts getEdgeCounts(
+    const std::function<uint64_t(const GPIOEventMonitor&)>& getCount)
+{
+    EdgeCounts edgeCounts;
+    for (const auto& [name, monitor] : gpioEventMonitors)
+    {
+        edgeCounts[name] = getCount(*monitor);
+    }
+    return edgeCounts;
 }
 
 static bool requestGPIOEvents(
-    const std::string& name, const std::function<void()>& handler,
+    const std::string& name,
+    const std::function<void(const gpiod::line_event&)>& handler,
     gpiod::line& gpioLine,
     boost::asio::posix::stream_descriptor& gpioEventDescriptor)
 {
-    // Find the GPIO line
-    gpioLine = gpiod::find_line(name);
+    const GPIOConfig& gpioConfig = gpioConfigs[name];
+    gpioLine = gpioConfig.line;
     if (!gpioLine)
     {
-        std::cerr << "Failed to find the " << name << " line\n";
-        return false;
+        // Missing required lines are already reported during resolution
+        return gpioConfig.optional;
     }
 
     try
     {
-        gpioLine.request(
-            {"power-control", gpiod::line_request::EVENT_BOTH_EDGES});
+        gpioLine.request({"power-control",
+                          gpiod::line_request::EVENT_BOTH_EDGES,
+                          getGPIORequestFlags(gpioConfig)});
     }
     catch (std::exception&)
     {
@@ -931,45 +3391,43 @@ static bool requestGPIOEvents(
 
     gpioEventDescriptor.assign(gpioLineFd);
 
-    gpioEventDescriptor.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [&name, handler](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << name << " fd handler error: " << ec.message()
-                          << "\n";
-                // TODO: throw here to force power-control to restart?
-                return;
-            }
-            handler();
-        });
+    uint32_t maxEdgesPerSecond = gpioConfig.maxEdgesPerSecond
+                                     ? gpioConfig.maxEdgesPerSecond
+                                     : edgeStormConfig.maxEdgesPerSecond;
+    auto& monitor = gpioEventMonitors[name];
+    monitor = std::make_unique<GPIOEventMonitor>(
+        name, gpioLine, gpioEventDescriptor, handler,
+        getGPIORequestFlags(gpioConfig), maxEdgesPerSecond);
+    monitor->lastEdge = getGPIOLevelEdge(*monitor);
+    waitForGPIOEvent(*monitor);
     return true;
 }
 
 static bool setGPIOOutput(const std::string& name, const int value,
                           gpiod::line& gpioLine)
 {
-    // Find the GPIO line
-    gpioLine = gpiod::find_line(name);
+    const GPIOConfig& gpioConfig = gpioConfigs[name];
+    gpioLine = gpioConfig.line;
     if (!gpioLine)
     {
-        std::cerr << "Failed to find the " << name << " line.\n";
+        logError(LogSubsystem::gpio, "Failed to find the ", name, " line.");
         return false;
     }
 
     // Request GPIO output to specified value
     try
     {
-        gpioLine.request({__FUNCTION__, gpiod::line_request::DIRECTION_OUTPUT},
+        gpioLine.request({__FUNCTION__, gpiod::line_request::DIRECTION_OUTPUT,
+                          getGPIORequestFlags(gpioConfig)},
                          value);
     }
     catch (std::exception&)
     {
-        std::cerr << "Failed to request " << name << " output\n";
+        logError(LogSubsystem::gpio, "Failed to request ", name, " output");
         return false;
     }
 
-    std::cerr << name << " set to " << std::to_string(value) << "\n";
+    logInfo(LogSubsystem::gpio, name, " set to ", value);
     return true;
 }
 
@@ -979,21 +3437,21 @@ static int setMaskedGPIOOutputForMs(gpiod::line& maskedGPIOLine,
 {
     // Set the masked GPIO line to the specified value
     maskedGPIOLine.set_value(value);
-    std::cerr << name << " set to " << std::to_string(value) << "\n";
+    logInfo(LogSubsystem::gpio, name, " set to ", value);
     gpioAssertTimer.expires_after(std::chrono::milliseconds(durationMs));
     gpioAssertTimer.async_wait(
         [maskedGPIOLine, value, name](const boost::system::error_code ec) {
             // Set the masked GPIO line back to the opposite value
             maskedGPIOLine.set_value(!value);
-            std::cerr << name << " released\n";
+            logInfo(LogSubsystem::gpio, name, " released");
             if (ec)
             {
                 // operation_aborted is expected if timer is canceled before
                 // completion.
                 if (ec != boost::asio::error::operation_aborted)
                 {
-                    std::cerr << name << " async_wait failed: " + ec.message()
-                              << "\n";
+                    logError(LogSubsystem::gpio, name,
+                             " async_wait failed: ", ec);
                 }
             }
         });
@@ -1004,12 +3462,12 @@ static int setGPIOOutputForMs(const std::string& name, const int value,
                               const int durationMs)
 {
     // If the requested GPIO is masked, use the mask line to set the output
-    if (powerButtonMask && name == "POWER_OUT")
+    if (powerButtonMask && name == powerOutName)
     {
         return setMaskedGPIOOutputForMs(powerButtonMask, name, value,
                                         durationMs);
     }
-    if (resetButtonMask && name == "RESET_OUT")
+    if (resetButtonMask && name == resetOutName)
     {
         return setMaskedGPIOOutputForMs(resetButtonMask, name, value,
                                         durationMs);
@@ -1024,15 +3482,17 @@ static int setGPIOOutputForMs(const std::string& name, const int value,
     gpioAssertTimer.expires_after(std::chrono::milliseconds(durationMs));
     gpioAssertTimer.async_wait(
         [gpioLine, name](const boost::system::error_code ec) {
-            std::cerr << name << " released\n";
+            // Release the line so it stops driving the output
+            gpioLine.release();
+            logInfo(LogSubsystem::gpio, name, " released");
             if (ec)
             {
                 // operation_aborted is expected if timer is canceled before
                 // completion.
                 if (ec != boost::asio::error::operation_aborted)
                 {
-                    std::cerr << name << " async_wait failed: " << ec.message()
-                              << "\n";
+                    logError(LogSubsystem::gpio, name,
+                             " async_wait failed: ", ec);
                 }
             }
         });
@@ -1041,17 +3501,17 @@ static int setGPIOOutputForMs(const std::string& name, const int value,
 
 static void powerOn()
 {
-    setGPIOOutputForMs("POWER_OUT", 0, powerPulseTimeMs);
+    setGPIOOutputForMs(powerOutName, 1, powerPulseTimeMs);
 }
 
 static void gracefulPowerOff()
 {
-    setGPIOOutputForMs("POWER_OUT", 0, powerPulseTimeMs);
+    setGPIOOutputForMs(powerOutName, 1, powerPulseTimeMs);
 }
 
 static void forcePowerOff()
 {
-    if (setGPIOOutputForMs("POWER_OUT", 0, forceOffPulseTimeMs) < 0)
+    if (setGPIOOutputForMs(powerOutName, 1, forceOffPulseTimeMs) < 0)
     {
         return;
     }
@@ -1065,13 +3525,14 @@ static void forcePowerOff()
             // completion.
             if (ec != boost::asio::error::operation_aborted)
             {
-                std::cerr << "Force power off async_wait failed: "
-                          << ec.message() << "\n";
+                logError(LogSubsystem::i2c,
+                         "Force power off async_wait failed: ", ec);
             }
             return;
         }
-        std::cerr << "PCH Power-button override failed. Issuing Unconditional "
-                     "Powerdown SMBus command.\n";
+        logInfo(LogSubsystem::i2c, "PCH Power-button override failed. "
+                                   "Issuing Unconditional Powerdown SMBus "
+                                   "command.");
         const static constexpr size_t pchDevBusAddress = 3;
         const static constexpr size_t pchDevSlaveAddress = 0x44;
         const static constexpr size_t pchCmdReg = 0;
@@ -1079,22 +3540,21 @@ static void forcePowerOff()
         if (i2cSet(pchDevBusAddress, pchDevSlaveAddress, pchCmdReg,
                    pchPowerDownCmd) < 0)
         {
-            std::cerr << "Unconditional Powerdown command failed! Not sure "
-                         "what to do now.\n";
+            logError(LogSubsystem::i2c, "Unconditional Powerdown command "
+                                        "failed! Not sure what to do now.");
         }
     });
 }
 
 static void reset()
 {
-    setGPIOOutputForMs("RESET_OUT", 0, resetPulseTimeMs);
+    setGPIOOutputForMs(resetOutName, 1, resetPulseTimeMs);
 }
 
-static void gracefulPowerOffTimerStart()
+static void gracefulPowerOffTimerStart(const std::chrono::milliseconds timeout)
 {
-    std::cerr << "Graceful power-off timer started\n";
-    gracefulPowerOffTimer.expires_after(
-        std::chrono::milliseconds(gracefulPowerOffTimeMs));
+    logDebug(LogSubsystem::timers, "Graceful power-off timer started");
+    gracefulPowerOffTimer.expires_after(timeout);
     gracefulPowerOffTimer.async_wait([](const boost::system::error_code ec) {
         if (ec)
         {
@@ -1102,21 +3562,27 @@ static void gracefulPowerOffTimerStart()
             // completion.
             if (ec != boost::asio::error::operation_aborted)
             {
-                std::cerr << "Graceful power-off async_wait failed: "
-                          << ec.message() << "\n";
+                logError(LogSubsystem::timers,
+                         "Graceful power-off async_wait failed: ", ec);
             }
-            std::cerr << "Graceful power-off timer canceled\n";
+            logDebug(LogSubsystem::timers, "Graceful power-off timer canceled");
             return;
         }
-        std::cerr << "Graceful power-off timer completed\n";
-        sendPowerControlEvent(Event::gracefulPowerOffTimerExpired);
+        logDebug(LogSubsystem::timers, "Graceful power-off timer completed");
+        sendPowerControlEvent(Event::gracefulPowerOffTimerExpired,
+                              gracefulPowerOffTimer.expiry());
     });
 }
+static void gracefulPowerOffTimerStart()
+{
+    gracefulPowerOffTimerStart(
+        std::chrono::milliseconds(gracefulPowerOffTimeMs));
+}
 
-static void powerCycleTimerStart()
+static void powerCycleTimerStart(const std::chrono::milliseconds timeout)
 {
-    std::cerr << "Power-cycle timer started\n";
-    powerCycleTimer.expires_after(std::chrono::milliseconds(powerCycleTimeMs));
+    logDebug(LogSubsystem::timers, "Power-cycle timer started");
+    powerCycleTimer.expires_after(timeout);
     powerCycleTimer.async_wait([](const boost::system::error_code ec) {
         if (ec)
         {
@@ -1124,22 +3590,27 @@ static void powerCycleTimerStart()
             // completion.
             if (ec != boost::asio::error::operation_aborted)
             {
-                std::cerr << "Power-cycle async_wait failed: " << ec.message()
-                          << "\n";
+                logError(LogSubsystem::timers,
+                         "Power-cycle async_wait failed: ", ec);
             }
-            std::cerr << "Power-cycle timer canceled\n";
+            logDebug(LogSubsystem::timers, "Power-cycle timer canceled");
             return;
         }
-        std::cerr << "Power-cycle timer completed\n";
-        sendPowerControlEvent(Event::powerCycleTimerExpired);
+        logDebug(LogSubsystem::timers, "Power-cycle timer completed");
+        sendPowerControlEvent(Event::powerCycleTimerExpired,
+                              powerCycleTimer.expiry());
     });
 }
+static void powerCycleTimerStart()
+{
+    powerCycleTimerStart(std::chrono::milliseconds(powerCycleTimeMs));
+}
 
-static void psPowerOKWatchdogTimerStart()
+static void psPowerOKWatchdogTimerStart(const std::chrono::milliseconds timeout)
 {
-    std::cerr << "power supply power OK watchdog timer started\n";
-    psPowerOKWatchdogTimer.expires_after(
-        std::chrono::milliseconds(psPowerOKWatchdogTimeMs));
+    logDebug(LogSubsystem::timers,
+             "power supply power OK watchdog timer started");
+    psPowerOKWatchdogTimer.expires_after(timeout);
     psPowerOKWatchdogTimer.async_wait(
         [](const boost::system::error_code ec) {
             if (ec)
@@ -1148,21 +3619,30 @@ static void psPowerOKWatchdogTimerStart()
                 // completion.
                 if (ec != boost::asio::error::operation_aborted)
                 {
-                    std::cerr
-                        << "power supply power OK watchdog async_wait failed: "
-                        << ec.message() << "\n";
+                    logError(LogSubsystem::timers,
+                             "power supply power OK watchdog async_wait "
+                             "failed: ",
+                             ec);
                 }
-                std::cerr << "power supply power OK watchdog timer canceled\n";
+                logDebug(LogSubsystem::timers,
+                         "power supply power OK watchdog timer canceled");
                 return;
             }
-            std::cerr << "power supply power OK watchdog timer expired\n";
-            sendPowerControlEvent(Event::psPowerOKWatchdogTimerExpired);
+            logDebug(LogSubsystem::timers,
+                     "power supply power OK watchdog timer expired");
+            sendPowerControlEvent(Event::psPowerOKWatchdogTimerExpired,
+                                  psPowerOKWatchdogTimer.expiry());
         });
 }
+static void psPowerOKWatchdogTimerStart()
+{
+    psPowerOKWatchdogTimerStart(
+        std::chrono::milliseconds(psPowerOKWatchdogTimeMs));
+}
 
 static void warmResetCheckTimerStart()
 {
-    std::cerr << "Warm reset check timer started\n";
+    logDebug(LogSubsystem::timers, "Warm reset check timer started");
     warmResetCheckTimer.expires_after(
         std::chrono::milliseconds(warmResetCheckTimeMs));
     warmResetCheckTimer.async_wait([](const boost::system::error_code ec) {
@@ -1172,22 +3652,99 @@ static void warmResetCheckTimerStart()
             // completion.
             if (ec != boost::asio::error::operation_aborted)
             {
-                std::cerr << "Warm reset check async_wait failed: "
-                          << ec.message() << "\n";
+                logError(LogSubsystem::timers,
+                         "Warm reset check async_wait failed: ", ec);
             }
-            std::cerr << "Warm reset check timer canceled\n";
+            logDebug(LogSubsystem::timers, "Warm reset check timer canceled");
             return;
         }
-        std::cerr << "Warm reset check timer completed\n";
-        sendPowerControlEvent(Event::warmResetDetected);
+        logDebug(LogSubsystem::timers, "Warm reset check timer completed");
+        sendPowerControlEvent(Event::warmResetDetected,
+                              warmResetCheckTimer.expiry());
     });
 }
 
+// Power-on hours are tracked in memory from the monotonic transition times
+// and checkpointed locally, so partial hours carry across restarts.  The
+// checkpoint is taken at every power state change, periodically and on
+// shutdown, and records the wall-clock time and whether the host was running,
+// so that time the host stays on while the daemon is down is counted too.
+// The POHCounter setting is only written when the whole hour count changes.
+const static constexpr int pohCheckpointTimeMs = 600000;
+const static constexpr uint64_t pohHourMs = 3600000;
+// Powered-on time before the current power-on period
+static uint64_t pohMs = 0;
+// Start of the current power-on period, if the host is running
+static std::optional<EventTime> pohStartTime;
+// Whether the count includes the POHCounter history, either from the local
+// file or from Settings.  Settings is not written until it does.
+static bool pohSeeded = false;
+static std::optional<uint32_t> pohSyncedHours;
+
+static uint64_t getPOHMs(const EventTime now)
+{
+    uint64_t ms = pohMs;
+    if (pohStartTime)
+    {
+        ms += std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now - *pohStartTime)
+                  .count();
+    }
+    return ms;
+}
+
+static void pohSave(const EventTime now)
+{
+    // An unseeded count would be taken as the whole history on the next
+    // start, losing the Settings counter
+    if (!pohSeeded)
+    {
+        return;
+    }
+    writeFileAtomic(powerControlDir / pohFile,
+                    std::to_string(getPOHMs(now)) + " " +
+                        std::to_string(getRealtimeMs(now)) + " " +
+                        std::to_string(pohStartTime.has_value()) + "\n");
+}
+
+static void pohSync(const EventTime now)
+{
+    if (!pohSeeded)
+    {
+        return;
+    }
+    uint32_t hours = getPOHMs(now) / pohHourMs;
+    if (pohSyncedHours == hours)
+    {
+        return;
+    }
+    if (getSetting<uint32_t>(pohCounterSetting) == hours)
+    {
+        pohSyncedHours = hours;
+        return;
+    }
+    callMethod<>(
+        requiredCallPolicy,
+        [hours](boost::system::error_code ec) {
+            if (ec)
+            {
+                std::cerr << "failed to set poh counter\n";
+                return;
+            }
+            pohSyncedHours = hours;
+        },
+        settingsService, pohCounterSetting.path,
+        "org.freedesktop.DBus.Properties", "Set", pohCounterSetting.interface,
+        pohCounterSetting.property, std::variant<uint32_t>(hours));
+}
+
 static void pohCounterTimerStart()
 {
-    std::cerr << "POH timer started\n";
-    // Set the time-out as 1 hour, to align with POH command in ipmid
-    pohCounterTimer.expires_after(std::chrono::hours(1));
+    // Wake for the next checkpoint or the next whole hour, whichever is first
+    uint64_t toNextHourMs =
+        pohHourMs - getPOHMs(std::chrono::steady_clock::now()) % pohHourMs;
+    pohCounterTimer.expires_after(std::chrono::milliseconds(
+        std::min<uint64_t>(toNextHourMs, pohCheckpointTimeMs)));
     pohCounterTimer.async_wait([](const boost::system::error_code& ec) {
         if (ec)
         {
@@ -1198,118 +3755,513 @@ static void pohCounterTimerStart()
                 std::cerr << "POH timer async_wait failed: " << ec.message()
                           << "\n";
             }
-            std::cerr << "POH timer canceled\n";
             return;
         }
+        pohSave(pohCounterTimer.expiry());
+        pohSync(pohCounterTimer.expiry());
+        pohCounterTimerStart();
+    });
+}
+
+static void pohStart(const EventTime time)
+{
+    if (pohStartTime)
+    {
+        return;
+    }
+    logInfo(LogSubsystem::timers, "POH counting started");
+    pohStartTime = time;
+    pohCounterTimerStart();
+}
 
-        if (getHostState(powerState) !=
-            "xyz.openbmc_project.State.Host.HostState.Running")
+static void pohStop(const EventTime time)
+{
+    if (!pohStartTime)
+    {
+        return;
+    }
+    logInfo(LogSubsystem::timers, "POH counting stopped");
+    pohCounterTimer.cancel();
+    pohMs = getPOHMs(time);
+    pohStartTime.reset();
+    pohSync(time);
+}
+
+static void pohCounterInit()
+{
+    bool running = getHostState(powerState) ==
+                   "xyz.openbmc_project.State.Host.HostState.Running";
+    std::ifstream pohStream(powerControlDir / pohFile);
+    if (pohStream >> pohMs)
+    {
+        pohSeeded = true;
+
+        // Checkpoints from before the time was recorded only hold the count
+        uint64_t checkpointRealtimeMs = 0;
+        bool checkpointRunning = false;
+        if (pohStream >> checkpointRealtimeMs >> checkpointRunning &&
+            checkpointRunning && running &&
+            powerStateChangeRealtimeMs > checkpointRealtimeMs)
         {
-            return;
+            uint64_t downMs = powerStateChangeRealtimeMs - checkpointRealtimeMs;
+            std::cerr << "Host stayed on, counting the " << downMs
+                      << "ms since the last POH checkpoint\n";
+            pohMs += downMs;
         }
+    }
+    else
+    {
+        // No local history yet, so seed it from the Settings counter
+        pohMs = 0;
+        watchSetting(pohCounterSetting, [](const SettingsValue& value) {
+            const uint32_t* hours = std::get_if<uint32_t>(&value);
+            if (hours == nullptr)
+            {
+                return false;
+            }
+            EventTime now = std::chrono::steady_clock::now();
+            pohMs += *hours * pohHourMs;
+            pohSeeded = true;
+            pohSave(now);
+            pohSync(now);
+            return true;
+        });
+    }
 
-        conn->async_method_call(
-            [](boost::system::error_code ec,
-               const std::variant<uint32_t>& pohCounterProperty) {
-                if (ec)
-                {
-                    std::cerr << "error to get poh counter\n";
-                    return;
-                }
-                const uint32_t* pohCounter =
-                    std::get_if<uint32_t>(&pohCounterProperty);
-                if (pohCounter == nullptr)
+    if (running)
+    {
+        pohStart(powerStateChangeTime);
+    }
+}
+
+static void currentHostStateMonitor()
+{
+    addPowerStateObserver([](const PowerState oldState,
+                             const PowerState newState) {
+        if (getHostState(oldState) != getHostState(newState))
+        {
+            if (getHostState(newState) ==
+                "xyz.openbmc_project.State.Host.HostState.Running")
+            {
+                pohStart(powerStateChangeTime);
+                // Clear the restart cause set for the next restart
+                clearRestartCause();
+            }
+            else
+            {
+                pohStop(powerStateChangeTime);
+                // Set the restart cause set for this restart
+                setRestartCause();
+            }
+        }
+        pohSave(powerStateChangeTime);
+    });
+}
+
+// Blocking transition methods.  Each method sends its request and defers the
+// reply until the state machine reaches the target state, fails, or the
+// timeout expires.  The reply carries the outcome and the elapsed time.
+const static constexpr int defaultTransitionTimeoutMs = 120000;
+static constexpr const char* transitionSuccess = "Success";
+static constexpr const char* transitionFailed = "Failed";
+static constexpr const char* transitionTimedOut = "TimedOut";
+static constexpr const char* transitionRejected = "Rejected";
+
+// Returns the outcome once a state change finishes the transition
+using TransitionCheck = std::function<std::optional<std::string>(
+    const PowerState oldState, const PowerState newState)>;
+struct TransitionWaiter
+{
+    TransitionCheck check;
+    boost::asio::steady_timer& timer;
+    std::optional<std::string> outcome;
+    EventTime completionTime;
+};
+static std::vector<TransitionWaiter*> transitionWaiters;
+using TransitionReply = std::tuple<std::string, uint64_t>;
+
+static void transitionWaitersObserver(const PowerState oldState,
+                                      const PowerState newState)
+{
+    for (TransitionWaiter* waiter : transitionWaiters)
+    {
+        if (waiter->outcome)
+        {
+            continue;
+        }
+        waiter->outcome = waiter->check(oldState, newState);
+        if (waiter->outcome)
+        {
+            waiter->completionTime = powerStateChangeTime;
+            waiter->timer.cancel();
+        }
+    }
+}
+
+static uint64_t getElapsedMs(const EventTime start, const EventTime end)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+        .count();
+}
+
+// Sends the request, unless it is already in progress, and waits for the
+// transition to finish.  A request that doesn't change the power state
+// straight away, other than one that may not (like a reset), was ignored.
+static TransitionReply waitForTransition(boost::asio::yield_context yield,
+                                         const std::optional<Event> event,
+                                         const uint32_t timeoutMs,
+                                         const TransitionCheck& check,
+                                         const bool changesState = true)
+{
+    EventTime startTime = std::chrono::steady_clock::now();
+    boost::asio::steady_timer timer(io);
+    TransitionWaiter waiter{check, timer, std::nullopt, startTime};
+    transitionWaiters.push_back(&waiter);
+
+    if (event)
+    {
+        PowerState startState = powerState;
+        addRestartCause(RestartCause::command);
+        sendPowerControlEvent(*event, startTime);
+        if (!waiter.outcome && changesState && powerState == startState)
+        {
+            // The request was ignored in this state
+            waiter.outcome = transitionRejected;
+        }
+    }
+    if (!waiter.outcome)
+    {
+        timer.expires_after(std::chrono::milliseconds(
+            timeoutMs > 0 ? timeoutMs : defaultTransitionTimeoutMs));
+        boost::system::error_code ec;
+        timer.async_wait(yield[ec]);
+    }
+
+    transitionWaiters.erase(std::remove(transitionWaiters.begin(),
+                                        transitionWaiters.end(), &waiter),
+                            transitionWaiters.end());
+    if (!waiter.outcome)
+    {
+        return {transitionTimedOut, getElapsedMs(startTime, timer.expiry())};
+    }
+    return {*waiter.outcome, getElapsedMs(startTime, waiter.completionTime)};
+}
+
+static TransitionReply powerOnMethod(boost::asio::yield_context yield,
+                                     const uint32_t timeoutMs)
+{
+    if (powerState == PowerState::on)
+    {
+        return {transitionSuccess, 0};
+    }
+    // A power-on already in progress is waited for rather than rejected
+    std::optional<Event> event = Event::powerOnRequest;
+    if (powerState == PowerState::waitForPSPowerOK ||
+        powerState == PowerState::waitForSIOPowerGood)
+    {
+        event.reset();
+    }
+    return waitForTransition(
+        yield, event, timeoutMs,
+        [](const PowerState, const PowerState newState)
+            -> std::optional<std::string> {
+            if (newState == PowerState::on)
+            {
+                return transitionSuccess;
+            }
+            if (newState == PowerState::failedTransitionToOn)
+            {
+                return transitionFailed;
+            }
+            return std::nullopt;
+        });
+}
+
+static TransitionReply powerOffMethod(boost::asio::yield_context yield,
+                                      const uint32_t timeoutMs)
+{
+    if (powerState == PowerState::off ||
+        powerState == PowerState::failedTransitionToOn)
+    {
+        return {transitionSuccess, 0};
+    }
+    return waitForTransition(
+        yield, Event::powerOffRequest, timeoutMs,
+        [](const PowerState, const PowerState newState)
+            -> std::optional<std::string> {
+            if (newState == PowerState::off)
+            {
+                return transitionSuccess;
+            }
+            return std::nullopt;
+        });
+}
+
+static TransitionReply powerCycleMethod(boost::asio::yield_context yield,
+                                        const uint32_t timeoutMs)
+{
+    return waitForTransition(
+        yield, Event::powerCycleRequest, timeoutMs,
+        [](const PowerState, const PowerState newState)
+            -> std::optional<std::string> {
+            if (newState == PowerState::on)
+            {
+                return transitionSuccess;
+            }
+            if (newState == PowerState::failedTransitionToOn)
+            {
+                return transitionFailed;
+            }
+            return std::nullopt;
+        });
+}
+
+static TransitionReply resetMethod(boost::asio::yield_context yield,
+                                   const uint32_t timeoutMs)
+{
+    if (powerState != PowerState::on)
+    {
+        return {transitionRejected, 0};
+    }
+    // The host drops POST_COMPLETE when it resets, and the reset is done
+    // once the warm reset check returns to on.  Any other state change means
+    // the host went off instead.
+    return waitForTransition(
+        yield, Event::resetRequest, timeoutMs,
+        [](const PowerState oldState, const PowerState newState)
+            -> std::optional<std::string> {
+            if (newState == PowerState::checkForWarmReset)
+            {
+                return std::nullopt;
+            }
+            if (oldState == PowerState::checkForWarmReset &&
+                newState == PowerState::on)
+            {
+                return transitionSuccess;
+            }
+            return transitionFailed;
+        },
+        false);
+}
+
+static void sioPowerGoodWatchdogTimerStart()
+{
+    logDebug(LogSubsystem::timers, "SIO power good watchdog timer started");
+    sioPowerGoodWatchdogTimer.expires_after(
+        std::chrono::milliseconds(sioPowerGoodWatchdogTimeMs));
+    sioPowerGoodWatchdogTimer.async_wait(
+        [](const boost::system::error_code ec) {
+            if (ec)
+            {
+                // operation_aborted is expected if timer is canceled before
+                // completion.
+                if (ec != boost::asio::error::operation_aborted)
                 {
-                    std::cerr << "unable to read poh counter\n";
-                    return;
+                    logError(LogSubsystem::timers,
+                             "SIO power good watchdog async_wait failed: ", ec);
                 }
+                logDebug(LogSubsystem::timers,
+                         "SIO power good watchdog timer canceled");
+                return;
+            }
+            logDebug(LogSubsystem::timers,
+                     "SIO power good watchdog timer completed");
+            sendPowerControlEvent(Event::sioPowerGoodWatchdogTimerExpired,
+                                  sioPowerGoodWatchdogTimer.expiry());
+        });
+}
 
-                conn->async_method_call(
-                    [](boost::system::error_code ec) {
-                        if (ec)
-                        {
-                            std::cerr << "failed to set poh counter\n";
-                        }
-                    },
-                    "xyz.openbmc_project.Settings",
-                    "/xyz/openbmc_project/state/chassis0",
-                    "org.freedesktop.DBus.Properties", "Set",
-                    "xyz.openbmc_project.State.PowerOnHours", "POHCounter",
-                    std::variant<uint32_t>(*pohCounter + 1));
-            },
-            "xyz.openbmc_project.Settings",
-            "/xyz/openbmc_project/state/chassis0",
-            "org.freedesktop.DBus.Properties", "Get",
-            "xyz.openbmc_project.State.PowerOnHours", "POHCounter");
+// Intent checkpoint.  After each transition the state, the deadline of the
+// timer it is waiting on and the restart causes are saved under /run, so a
+// restarted daemon can resume an operation that was in flight within what
+// is left of its time budget.
+const static std::filesystem::path intentCheckpointFile =
+    "/run/power-control/intent";
+const static constexpr int intentCheckpointVersion = 1;
+// An older checkpoint is stale, e.g. the daemon was stopped, not restarted
+const static constexpr int maxIntentAgeMs = 120000;
+
+struct IntentCheckpoint
+{
+    PowerState state;
+    uint32_t causeMask;
+    EventTime checkpointTime;
+    std::optional<EventTime> deadline;
+};
 
-        pohCounterTimerStart();
-    });
+// The timer each waiting state is bounded by
+static boost::asio::steady_timer* getIntentTimer(const PowerState state)
+{
+    switch (state)
+    {
+        case PowerState::waitForPSPowerOK:
+            return &psPowerOKWatchdogTimer;
+        case PowerState::waitForSIOPowerGood:
+            return &sioPowerGoodWatchdogTimer;
+        case PowerState::gracefulTransitionToOff:
+        case PowerState::gracefulTransitionToCycleOff:
+            return &gracefulPowerOffTimer;
+        case PowerState::cycleOff:
+            return &powerCycleTimer;
+        case PowerState::checkForWarmReset:
+            return &warmResetCheckTimer;
+        default:
+            return nullptr;
+    }
+}
+
+static void saveIntentCheckpoint()
+{
+    uint32_t causeMask = 0;
+    for (const RestartCause cause : causeSet)
+    {
+        causeMask |= 1U << static_cast<unsigned>(cause);
+    }
+    boost::asio::steady_timer* timer = getIntentTimer(powerState);
+    uint64_t deadlineNs =
+        timer != nullptr ? getMonotonicNs(timer->expiry()) : 0;
+
+    // /run is tmpfs, so a rename is all it takes to survive a daemon crash
+    std::filesystem::path tmpPath = intentCheckpointFile;
+    tmpPath += ".tmp";
+    {
+        std::ofstream checkpointStream(tmpPath);
+        checkpointStream << intentCheckpointVersion << " "
+                         << static_cast<int>(powerState) << " " << causeMask
+                         << " "
+                         << getMonotonicNs(std::chrono::steady_clock::now())
+                         << " " << deadlineNs << "\n";
+        if (!checkpointStream)
+        {
+            std::cerr << "failed to write " << tmpPath << "\n";
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, intentCheckpointFile, ec);
+    if (ec)
+    {
+        std::cerr << "failed to save the intent checkpoint: " << ec.message()
+                  << "\n";
+    }
 }
 
-static void currentHostStateMonitor()
+static std::optional<IntentCheckpoint> loadIntentCheckpoint()
 {
-    static auto match = sdbusplus::bus::match::match(
-        *conn,
-        "type='signal',member='PropertiesChanged', "
-        "interface='org.freedesktop.DBus.Properties', "
-        "arg0namespace='xyz.openbmc_project.State.Host'",
-        [](sdbusplus::message::message& message) {
-            std::string intfName;
-            std::map<std::string, std::variant<std::string>> properties;
+    std::ifstream checkpointStream(intentCheckpointFile);
+    int version = 0;
+    int state = 0;
+    uint32_t causeMask = 0;
+    uint64_t checkpointNs = 0;
+    uint64_t deadlineNs = 0;
+    if (!(checkpointStream >> version >> state >> causeMask >> checkpointNs >>
+          deadlineNs) ||
+        version != intentCheckpointVersion || state < 0 ||
+        static_cast<size_t>(state) >=
+            power_event_journal::powerStateNames.size())
+    {
+        return std::nullopt;
+    }
+    IntentCheckpoint checkpoint{
+        static_cast<PowerState>(state), causeMask,
+        EventTime(std::chrono::nanoseconds(checkpointNs)), std::nullopt};
+    if (deadlineNs != 0)
+    {
+        checkpoint.deadline = EventTime(std::chrono::nanoseconds(deadlineNs));
+    }
+    return checkpoint;
+}
 
-            message.read(intfName, properties);
+// Resume the checkpointed intent, given the state found from the live GPIO
+// levels.  This runs before the D-Bus interfaces exist, so the state is set
+// directly like the initial state.
+static void resumeIntent()
+{
+    std::optional<IntentCheckpoint> checkpoint = loadIntentCheckpoint();
+    if (!checkpoint)
+    {
+        return;
+    }
+    EventTime now = std::chrono::steady_clock::now();
+    if (now - checkpoint->checkpointTime >
+        std::chrono::milliseconds(maxIntentAgeMs))
+    {
+        return;
+    }
 
-            std::variant<std::string> currentHostState;
+    for (size_t cause = 0;
+         cause < power_event_journal::restartCauseNames.size(); cause++)
+    {
+        if (checkpoint->causeMask & (1U << cause))
+        {
+            causeSet.insert(static_cast<RestartCause>(cause));
+        }
+    }
 
-            try
+    auto remaining = std::chrono::milliseconds(0);
+    if (checkpoint->deadline && *checkpoint->deadline > now)
+    {
+        remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            *checkpoint->deadline - now);
+    }
+    PowerState liveState = powerState;
+    switch (checkpoint->state)
+    {
+        case PowerState::waitForPSPowerOK:
+            // The power button pulse already went out, so only the wait for
+            // power OK is resumed
+            if (liveState == PowerState::off && remaining.count() > 0)
             {
-                currentHostState = properties.at("CurrentHostState");
+                powerState = PowerState::waitForPSPowerOK;
+                psPowerOKWatchdogTimerStart(remaining);
             }
-            catch (const std::out_of_range& e)
+            break;
+        case PowerState::gracefulTransitionToOff:
+        case PowerState::gracefulTransitionToCycleOff:
+            if (liveState == PowerState::on && remaining.count() > 0)
             {
-                std::cerr << "Error in finding CurrentHostState property\n";
-
-                return;
+                powerState = checkpoint->state;
+                gracefulPowerOffTimerStart(remaining);
             }
-
-            if (std::get<std::string>(currentHostState) ==
-                "xyz.openbmc_project.State.Host.HostState.Running")
+            else if (liveState == PowerState::off &&
+                     checkpoint->state ==
+                         PowerState::gracefulTransitionToCycleOff)
             {
-                pohCounterTimerStart();
-                // Clear the restart cause set for the next restart
-                clearRestartCause();
+                powerState = PowerState::cycleOff;
+                powerCycleTimerStart();
             }
-            else
+            break;
+        case PowerState::transitionToOff:
+        case PowerState::transitionToCycleOff:
+            if (liveState == PowerState::on)
             {
-                pohCounterTimer.cancel();
-                // Set the restart cause set for this restart
-                setRestartCause();
+                // The force-off pulse was released when the daemon stopped
+                powerState = checkpoint->state;
+                forcePowerOff();
             }
-        });
-}
-
-static void sioPowerGoodWatchdogTimerStart()
-{
-    std::cerr << "SIO power good watchdog timer started\n";
-    sioPowerGoodWatchdogTimer.expires_after(
-        std::chrono::milliseconds(sioPowerGoodWatchdogTimeMs));
-    sioPowerGoodWatchdogTimer.async_wait(
-        [](const boost::system::error_code ec) {
-            if (ec)
+            else if (liveState == PowerState::off &&
+                     checkpoint->state == PowerState::transitionToCycleOff)
             {
-                // operation_aborted is expected if timer is canceled before
-                // completion.
-                if (ec != boost::asio::error::operation_aborted)
-                {
-                    std::cerr << "SIO power good watchdog async_wait failed: "
-                              << ec.message() << "\n";
-                }
-                std::cerr << "SIO power good watchdog timer canceled\n";
-                return;
+                powerState = PowerState::cycleOff;
+                powerCycleTimerStart();
             }
-            std::cerr << "SIO power good watchdog timer completed\n";
-            sendPowerControlEvent(Event::sioPowerGoodWatchdogTimerExpired);
-        });
+            break;
+        case PowerState::cycleOff:
+            if (liveState == PowerState::off)
+            {
+                powerState = PowerState::cycleOff;
+                powerCycleTimerStart(remaining);
+            }
+            break;
+        default:
+            // The live GPIO levels already give the state
+            break;
+    }
+    if (powerState != liveState)
+    {
+        std::cerr << "Resuming \"" << getPowerStateName(powerState)
+                  << "\" from before the restart\n";
+    }
 }
 
 static void powerStateOn(const Event event)
@@ -1323,12 +4275,12 @@ static void powerStateOn(const Event event)
             beep(beepPowerFail);
             break;
         case Event::sioS5Assert:
-            setPowerState(PowerState::transitionToOff);
             addRestartCause(RestartCause::softReset);
+            setPowerState(PowerState::transitionToOff);
             break;
         case Event::postCompleteDeAssert:
-            setPowerState(PowerState::checkForWarmReset);
             addRestartCause(RestartCause::softReset);
+            setPowerState(PowerState::checkForWarmReset);
             warmResetCheckTimerStart();
             break;
         case Event::powerButtonPressed:
@@ -1361,7 +4313,7 @@ static void powerStateOn(const Event event)
             reset();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1383,7 +4335,7 @@ static void powerStateWaitForPSPowerOK(const Event event)
             psPowerOKFailedLog();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1403,7 +4355,7 @@ static void powerStateWaitForSIOPowerGood(const Event event)
             forcePowerOff();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1432,7 +4384,7 @@ static void powerStateFailedTransitionToOn(const Event event)
             powerOn();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1458,7 +4410,7 @@ static void powerStateOff(const Event event)
             powerOn();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1474,7 +4426,7 @@ static void powerStateTransitionToOff(const Event event)
             setPowerState(PowerState::off);
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1492,7 +4444,7 @@ static void powerStateGracefulTransitionToOff(const Event event)
             setPowerState(PowerState::on);
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1508,7 +4460,7 @@ static void powerStateCycleOff(const Event event)
             powerOn();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1525,7 +4477,7 @@ static void powerStateTransitionToCycleOff(const Event event)
             powerCycleTimerStart();
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1544,7 +4496,7 @@ static void powerStateGracefulTransitionToCycleOff(const Event event)
             setPowerState(PowerState::on);
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
@@ -1562,172 +4514,105 @@ static void powerStateCheckForWarmReset(const Event event)
             setPowerState(PowerState::on);
             break;
         default:
-            std::cerr << "No action taken.\n";
+            logDebug(LogSubsystem::stateMachine, "No action taken.");
             break;
     }
 }
 
-static void psPowerOKHandler()
+static void psPowerOKHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = psPowerOKLine.event_read();
-
     Event powerControlEvent =
         gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE
             ? Event::psPowerOKAssert
             : Event::psPowerOKDeAssert;
 
-    sendPowerControlEvent(powerControlEvent);
-    psPowerOKEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "power supply power OK handler error: "
-                          << ec.message() << "\n";
-                return;
-            }
-            psPowerOKHandler();
-        });
+    sendPowerControlEvent(powerControlEvent, getGPIOEventTime(gpioLineEvent));
 }
 
-static void sioPowerGoodHandler()
+static void sioPowerGoodHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = sioPowerGoodLine.event_read();
-
     Event powerControlEvent =
         gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE
             ? Event::sioPowerGoodAssert
             : Event::sioPowerGoodDeAssert;
 
-    sendPowerControlEvent(powerControlEvent);
-    sioPowerGoodEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "SIO power good handler error: " << ec.message()
-                          << "\n";
-                return;
-            }
-            sioPowerGoodHandler();
-        });
+    sendPowerControlEvent(powerControlEvent, getGPIOEventTime(gpioLineEvent));
 }
 
-static void sioOnControlHandler()
+static void sioOnControlHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = sioOnControlLine.event_read();
-
     bool sioOnControl =
         gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE;
     std::cerr << "SIO_ONCONTROL value changed: " << sioOnControl << "\n";
-    sioOnControlEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "SIO ONCONTROL handler error: " << ec.message()
-                          << "\n";
-                return;
-            }
-            sioOnControlHandler();
-        });
 }
 
-static void sioS5Handler()
+static void sioS5Handler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = sioS5Line.event_read();
-
     Event powerControlEvent =
-        gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE
+        gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE
             ? Event::sioS5Assert
             : Event::sioS5DeAssert;
 
-    sendPowerControlEvent(powerControlEvent);
-    sioS5Event.async_wait(boost::asio::posix::stream_descriptor::wait_read,
-                          [](const boost::system::error_code ec) {
-                              if (ec)
-                              {
-                                  std::cerr << "SIO S5 handler error: "
-                                            << ec.message() << "\n";
-                                  return;
-                              }
-                              sioS5Handler();
-                          });
+    sendPowerControlEvent(powerControlEvent, getGPIOEventTime(gpioLineEvent));
 }
 
-static void powerButtonHandler()
+static void setButtonPressed(sdbusplus::asio::dbus_interface& buttonIface,
+                             const std::string& name, const bool pressed)
 {
-    gpiod::line_event gpioLineEvent = powerButtonLine.event_read();
+    buttonsPressed[name] = pressed;
+    buttonIface.set_property("ButtonPressed", pressed);
+}
 
-    if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
+static void powerButtonHandler(const gpiod::line_event& gpioLineEvent)
+{
+    if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
     {
         powerButtonPressLog();
-        powerButtonIface->set_property("ButtonPressed", true);
+        setButtonPressed(*powerButtonIface, powerButtonName, true);
         if (!powerButtonMask)
         {
-            sendPowerControlEvent(Event::powerButtonPressed);
             addRestartCause(RestartCause::powerButton);
+            sendPowerControlEvent(Event::powerButtonPressed,
+                                  getGPIOEventTime(gpioLineEvent));
         }
         else
         {
-            std::cerr << "power button press masked\n";
+            logInfo(LogSubsystem::gpio, "power button press masked");
         }
     }
-    else if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
+    else if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
     {
-        powerButtonIface->set_property("ButtonPressed", false);
+        setButtonPressed(*powerButtonIface, powerButtonName, false);
     }
-    powerButtonEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "power button handler error: " << ec.message()
-                          << "\n";
-                return;
-            }
-            powerButtonHandler();
-        });
 }
 
-static void resetButtonHandler()
+static void resetButtonHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = resetButtonLine.event_read();
-
-    if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
+    if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
     {
         resetButtonPressLog();
-        resetButtonIface->set_property("ButtonPressed", true);
+        setButtonPressed(*resetButtonIface, resetButtonName, true);
         if (!resetButtonMask)
         {
-            sendPowerControlEvent(Event::resetButtonPressed);
             addRestartCause(RestartCause::resetButton);
+            sendPowerControlEvent(Event::resetButtonPressed,
+                                  getGPIOEventTime(gpioLineEvent));
         }
         else
         {
-            std::cerr << "reset button press masked\n";
+            logInfo(LogSubsystem::gpio, "reset button press masked");
         }
     }
-    else if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
+    else if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
     {
-        resetButtonIface->set_property("ButtonPressed", false);
+        setButtonPressed(*resetButtonIface, resetButtonName, false);
     }
-    resetButtonEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
-            {
-                std::cerr << "reset button handler error: " << ec.message()
-                          << "\n";
-                return;
-            }
-            resetButtonHandler();
-        });
 }
 
 static void nmiSetEnablePorperty(bool value)
 {
-    conn->async_method_call(
+    callMethod<>(
+        requiredCallPolicy,
         [](boost::system::error_code ec) {
             if (ec)
             {
@@ -1776,48 +4661,28 @@ static void nmiSourcePropertyMonitor(void)
 {
     std::cerr << " NMI Source Property Monitor \n";
 
-    static std::unique_ptr<sdbusplus::bus::match::match> nmiSourceMatch =
-        std::make_unique<sdbusplus::bus::match::match>(
-            *conn,
-            "type='signal',interface='org.freedesktop.DBus.Properties',"
-            "member='PropertiesChanged',arg0namespace='xyz.openbmc_project."
-            "Chassis.Control."
-            "NMISource'",
-            [](sdbusplus::message::message& msg) {
-                std::string interfaceName;
-                boost::container::flat_map<std::string,
-                                           std::variant<bool, std::string>>
-                    propertiesChanged;
-                std::string state;
-                bool value = true;
-                try
-                {
-                    msg.read(interfaceName, propertiesChanged);
-                    if (propertiesChanged.begin()->first == "Enabled")
-                    {
-                        value =
-                            std::get<bool>(propertiesChanged.begin()->second);
-                        std::cerr
-                            << " NMI Enabled propertiesChanged value: " << value
-                            << "\n";
-                        nmiEnabled = value;
-                        if (nmiEnabled)
-                        {
-                            nmiReset();
-                        }
-                    }
-                }
-                catch (std::exception& e)
-                {
-                    std::cerr << "Unable to read NMI source\n";
-                    return;
-                }
-            });
+    watchSettingChanges(nmiEnabledSetting, [](const SettingsValue& property) {
+        const bool* value = std::get_if<bool>(&property);
+        if (value == nullptr)
+        {
+            std::cerr << "Unable to read NMI source\n";
+            return false;
+        }
+        std::cerr << " NMI Enabled propertiesChanged value: " << *value
+                  << "\n";
+        nmiEnabled = *value;
+        if (nmiEnabled)
+        {
+            nmiReset();
+        }
+        return false;
+    });
 }
 
 static void setNmiSource()
 {
-    conn->async_method_call(
+    callMethod<>(
+        requiredCallPolicy,
         [](boost::system::error_code ec) {
             if (ec)
             {
@@ -1834,112 +4699,214 @@ static void setNmiSource()
     nmiSetEnablePorperty(true);
 }
 
-static void nmiButtonHandler()
+static void nmiButtonHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = nmiButtonLine.event_read();
-
-    if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
+    if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
     {
         nmiButtonPressLog();
-        nmiButtonIface->set_property("ButtonPressed", true);
+        setButtonPressed(*nmiButtonIface, nmiButtonName, true);
         if (nmiButtonMasked)
         {
-            std::cerr << "NMI button press masked\n";
+            logInfo(LogSubsystem::gpio, "NMI button press masked");
         }
         else
         {
             setNmiSource();
         }
     }
-    else if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
+    else if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
     {
-        nmiButtonIface->set_property("ButtonPressed", false);
+        setButtonPressed(*nmiButtonIface, nmiButtonName, false);
     }
-    nmiButtonEvent.async_wait(boost::asio::posix::stream_descriptor::wait_read,
-                              [](const boost::system::error_code ec) {
-                                  if (ec)
-                                  {
-                                      std::cerr << "NMI button handler error: "
-                                                << ec.message() << "\n";
-                                      return;
-                                  }
-                                  nmiButtonHandler();
-                              });
 }
 
-static void idButtonHandler()
+static void idButtonHandler(const gpiod::line_event& gpioLineEvent)
 {
-    gpiod::line_event gpioLineEvent = idButtonLine.event_read();
-
-    if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
+    if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
     {
-        idButtonIface->set_property("ButtonPressed", true);
+        setButtonPressed(*idButtonIface, idButtonName, true);
     }
-    else if (gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE)
+    else if (gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE)
     {
-        idButtonIface->set_property("ButtonPressed", false);
+        setButtonPressed(*idButtonIface, idButtonName, false);
     }
-    idButtonEvent.async_wait(boost::asio::posix::stream_descriptor::wait_read,
-                             [](const boost::system::error_code& ec) {
-                                 if (ec)
-                                 {
-                                     std::cerr << "ID button handler error: "
-                                               << ec.message() << "\n";
-                                     return;
-                                 }
-                                 idButtonHandler();
-                             });
 }
 
-static void postCompleteHandler()
+static void setOperatingSystemState(const std::string& state)
 {
-    gpiod::line_event gpioLineEvent = postCompleteLine.event_read();
+    operatingSystemState = state;
+    osIface->set_property("OperatingSystemState", state);
+}
 
+static void postCompleteHandler(const gpiod::line_event& gpioLineEvent)
+{
     bool postComplete =
-        gpioLineEvent.event_type == gpiod::line_event::FALLING_EDGE;
+        gpioLineEvent.event_type == gpiod::line_event::RISING_EDGE;
     if (postComplete)
     {
-        sendPowerControlEvent(Event::postCompleteAssert);
-        osIface->set_property("OperatingSystemState", std::string("Standby"));
+        sendPowerControlEvent(Event::postCompleteAssert,
+                              getGPIOEventTime(gpioLineEvent));
+        setOperatingSystemState("Standby");
     }
     else
     {
-        sendPowerControlEvent(Event::postCompleteDeAssert);
-        osIface->set_property("OperatingSystemState", std::string("Inactive"));
+        sendPowerControlEvent(Event::postCompleteDeAssert,
+                              getGPIOEventTime(gpioLineEvent));
+        setOperatingSystemState("Inactive");
     }
-    postCompleteEvent.async_wait(
-        boost::asio::posix::stream_descriptor::wait_read,
-        [](const boost::system::error_code ec) {
-            if (ec)
+}
+
+// Versioned snapshot of the whole chassis state, so clients can read it in one
+// call instead of polling each property on its own object
+static constexpr uint32_t powerStatusVersion = 1;
+using PowerStatusValue = std::variant<bool, uint64_t, std::string>;
+using PowerStatus = boost::container::flat_map<std::string, PowerStatusValue>;
+
+static std::tuple<uint32_t, PowerStatus> getPowerStatus()
+{
+    PowerStatus status;
+    status["CurrentHostState"] = std::string(getHostState(powerState));
+    status["CurrentPowerState"] = std::string(getChassisState(powerState));
+    status["LastStateChangeTime"] = powerStateChangeRealtimeMs;
+    status["OperatingSystemState"] = operatingSystemState;
+    status["RestartCause"] = currentRestartCause;
+    status["PowerState"] = std::string(getPowerStateName(powerState));
+    status["PowerButtonPressed"] = buttonsPressed[powerButtonName];
+    status["PowerButtonMasked"] = static_cast<bool>(powerButtonMask);
+    status["ResetButtonPressed"] = buttonsPressed[resetButtonName];
+    status["ResetButtonMasked"] = static_cast<bool>(resetButtonMask);
+    status["NMIButtonPressed"] = buttonsPressed[nmiButtonName];
+    status["NMIButtonMasked"] = nmiButtonMasked;
+    status["IDButtonPressed"] = buttonsPressed[idButtonName];
+    return {powerStatusVersion, status};
+}
+
+// Sampled input line values, keyed by GPIO role
+using LineValues = boost::container::flat_map<std::string, int>;
+
+static LineValues sampleInputLines()
+{
+    // Read every requested input line with one bulk read per chip, since a
+    // bulk read cannot span chips
+    boost::container::flat_map<std::string, std::pair<gpiod::line_bulk,
+                                                      std::vector<std::string>>>
+        chipLines;
+    for (const auto& [name, monitor] : gpioEventMonitors)
+    {
+        auto& [bulk, names] = chipLines[monitor->line.get_chip().name()];
+        bulk.append(monitor->line);
+        names.push_back(name);
+    }
+
+    LineValues lineValues;
+    for (const auto& [chipName, lines] : chipLines)
+    {
+        const auto& [bulk, names] = lines;
+        try
+        {
+            std::vector<int> values = bulk.get_values();
+            for (size_t i = 0; i < names.size() && i < values.size(); i++)
             {
-                std::cerr << "POST complete handler error: " << ec.message()
-                          << "\n";
-                return;
+                lineValues[names[i]] = values[i];
             }
-            postCompleteHandler();
-        });
+        }
+        catch (std::exception&)
+        {
+            std::cerr << "Failed to read input lines on " << chipName << "\n";
+        }
+    }
+    return lineValues;
+}
+
+// Power state implied by each combination of PS_PWROK, SIO_POWER_GOOD and
+// SIO_S5 levels, so that a restart in the middle of a transition resumes it
+struct InitialPowerState
+{
+    bool psPowerOK;
+    bool sioPowerGood;
+    bool sioS5;
+    PowerState state;
+};
+static constexpr std::array<InitialPowerState, 8> initialPowerStates = {{
+    {false, false, false, PowerState::waitForPSPowerOK},
+    {false, false, true, PowerState::off},
+    {false, true, false, PowerState::waitForPSPowerOK},
+    {false, true, true, PowerState::off},
+    {true, false, false, PowerState::waitForSIOPowerGood},
+    {true, false, true, PowerState::transitionToOff},
+    {true, true, false, PowerState::on},
+    {true, true, true, PowerState::transitionToOff},
+}};
+
+static void initializePowerState(const LineValues& lineValues)
+{
+    auto isAsserted = [&lineValues](const char* name, bool unknown) {
+        auto it = lineValues.find(name);
+        return it == lineValues.end() ? unknown : it->second > 0;
+    };
+    // A line that could not be read is assumed to be at its powered-off level
+    bool psPowerOK = isAsserted(psPowerOKName, false);
+    bool sioPowerGood = isAsserted(sioPowerGoodName, false);
+    bool sioS5 = isAsserted(sioS5Name, true);
+
+    powerState = PowerState::off;
+    for (const InitialPowerState& initialState : initialPowerStates)
+    {
+        if (initialState.psPowerOK == psPowerOK &&
+            initialState.sioPowerGood == sioPowerGood &&
+            initialState.sioS5 == sioS5)
+        {
+            powerState = initialState.state;
+            break;
+        }
+    }
+
+    // Re-arm the watchdog for a power-on that was already in progress
+    switch (powerState)
+    {
+        case PowerState::waitForPSPowerOK:
+            psPowerOKWatchdogTimerStart();
+            break;
+        case PowerState::waitForSIOPowerGood:
+            sioPowerGoodWatchdogTimerStart();
+            break;
+        default:
+            break;
+    }
 }
 } // namespace power_control
 
 int main(int argc, char* argv[])
 {
     std::cerr << "Start Chassis power control service...\n";
+    power_control::startupStartTime = std::chrono::steady_clock::now();
     power_control::conn =
         std::make_shared<sdbusplus::asio::connection>(power_control::io);
-
-    // Request all the dbus names
-    power_control::conn->request_name("xyz.openbmc_project.State.Host");
-    power_control::conn->request_name("xyz.openbmc_project.State.Chassis");
-    power_control::conn->request_name(
-        "xyz.openbmc_project.State.OperatingSystem");
-    power_control::conn->request_name("xyz.openbmc_project.Chassis.Buttons");
-    power_control::conn->request_name("xyz.openbmc_project.Control.Host.NMI");
-    power_control::conn->request_name(
-        "xyz.openbmc_project.Control.Host.RestartCause");
+    power_control::startupPhaseDone("D-Bus connected");
+
+    // Request all the dbus names and load the settings used by the policies
+    // below.  The replies are handled once the GPIOs are set up.
+    power_control::requestNames(
+        {"xyz.openbmc_project.State.Host", "xyz.openbmc_project.State.Chassis",
+         "xyz.openbmc_project.State.OperatingSystem",
+         "xyz.openbmc_project.Chassis.Buttons",
+         "xyz.openbmc_project.Control.Host.NMI",
+         "xyz.openbmc_project.Control.Host.RestartCause"});
+    power_control::settingsCacheInit();
+
+    // Apply the saved log levels before anything is logged
+    power_control::logLevelsInit();
+
+    // Load the GPIO line mapping and find all the lines
+    power_control::loadPowerConfig();
+    if (!power_control::resolveGPIOLines())
+    {
+        return -1;
+    }
 
     // Request PS_PWROK GPIO events
     if (!power_control::requestGPIOEvents(
-            "PS_PWROK", power_control::psPowerOKHandler,
+            power_control::psPowerOKName, power_control::psPowerOKHandler,
             power_control::psPowerOKLine, power_control::psPowerOKEvent))
     {
         return -1;
@@ -1947,7 +4914,7 @@ int main(int argc, char* argv[])
 
     // Request SIO_POWER_GOOD GPIO events
     if (!power_control::requestGPIOEvents(
-            "SIO_POWER_GOOD", power_control::sioPowerGoodHandler,
+            power_control::sioPowerGoodName, power_control::sioPowerGoodHandler,
             power_control::sioPowerGoodLine, power_control::sioPowerGoodEvent))
     {
         return -1;
@@ -1955,23 +4922,23 @@ int main(int argc, char* argv[])
 
     // Request SIO_ONCONTROL GPIO events
     if (!power_control::requestGPIOEvents(
-            "SIO_ONCONTROL", power_control::sioOnControlHandler,
+            power_control::sioOnControlName, power_control::sioOnControlHandler,
             power_control::sioOnControlLine, power_control::sioOnControlEvent))
     {
         return -1;
     }
 
     // Request SIO_S5 GPIO events
-    if (!power_control::requestGPIOEvents("SIO_S5", power_control::sioS5Handler,
-                                          power_control::sioS5Line,
-                                          power_control::sioS5Event))
+    if (!power_control::requestGPIOEvents(
+            power_control::sioS5Name, power_control::sioS5Handler,
+            power_control::sioS5Line, power_control::sioS5Event))
     {
         return -1;
     }
 
     // Request POWER_BUTTON GPIO events
     if (!power_control::requestGPIOEvents(
-            "POWER_BUTTON", power_control::powerButtonHandler,
+            power_control::powerButtonName, power_control::powerButtonHandler,
             power_control::powerButtonLine, power_control::powerButtonEvent))
     {
         return -1;
@@ -1979,7 +4946,7 @@ int main(int argc, char* argv[])
 
     // Request RESET_BUTTON GPIO events
     if (!power_control::requestGPIOEvents(
-            "RESET_BUTTON", power_control::resetButtonHandler,
+            power_control::resetButtonName, power_control::resetButtonHandler,
             power_control::resetButtonLine, power_control::resetButtonEvent))
     {
         return -1;
@@ -1987,7 +4954,7 @@ int main(int argc, char* argv[])
 
     // Request NMI_BUTTON GPIO events
     if (!power_control::requestGPIOEvents(
-            "NMI_BUTTON", power_control::nmiButtonHandler,
+            power_control::nmiButtonName, power_control::nmiButtonHandler,
             power_control::nmiButtonLine, power_control::nmiButtonEvent))
     {
         return -1;
@@ -1995,7 +4962,7 @@ int main(int argc, char* argv[])
 
     // Request ID_BUTTON GPIO events
     if (!power_control::requestGPIOEvents(
-            "ID_BUTTON", power_control::idButtonHandler,
+            power_control::idButtonName, power_control::idButtonHandler,
             power_control::idButtonLine, power_control::idButtonEvent))
     {
         return -1;
@@ -2003,7 +4970,7 @@ int main(int argc, char* argv[])
 
     // Request POST_COMPLETE GPIO events
     if (!power_control::requestGPIOEvents(
-            "POST_COMPLETE", power_control::postCompleteHandler,
+            power_control::postCompleteName, power_control::postCompleteHandler,
             power_control::postCompleteLine, power_control::postCompleteEvent))
     {
         return -1;
@@ -2016,35 +4983,56 @@ int main(int argc, char* argv[])
         return -1;
     }
 
-    // Initialize the power state
-    power_control::powerState = power_control::PowerState::off;
-    // Check power good
-    if (power_control::psPowerOKLine.get_value() > 0)
-    {
-        power_control::powerState = power_control::PowerState::on;
-    }
+    power_control::startupPhaseDone("GPIO lines requested");
+
+    // Initialize the power state from a single sample of all the inputs
+    power_control::LineValues lineValues = power_control::sampleInputLines();
+    power_control::setPowerStateChangeTime(std::chrono::steady_clock::now());
+    power_control::initializePowerState(lineValues);
 
     // Initialize the power state storage
     if (power_control::initializePowerStateStorage() < 0)
     {
         return -1;
     }
+    power_control::openEventJournal();
+    power_control::flightRecorderInit();
+    power_control::resumeIntent();
+    power_control::saveIntentCheckpoint();
+    power_control::journalPowerState(
+        power_event_journal::RecordType::start, power_control::powerState,
+        power_control::powerState, power_event_journal::unknownCode,
+        power_control::powerStateChangeTime, false);
+
+    // Restore the power-on hours and count them if the host is running
+    power_control::pohCounterInit();
 
     // Check if we need to start the Power Restore policy
+    power_control::localRestorePolicyInit();
+    power_control::powerRestorePolicyLocalCheck();
     power_control::powerRestorePolicyCheck();
 
     power_control::nmiSourcePropertyMonitor();
 
-    std::cerr << "Initializing power state. ";
-    power_control::logStateTransition(power_control::powerState);
-
-    // Power Control Service
-    sdbusplus::asio::object_server hostServer =
+    power_control::logInfo(
+        power_control::LogSubsystem::stateMachine,
+        "Initializing power state. Moving to \"",
+        power_control::getPowerStateName(power_control::powerState),
+        "\" state.");
+    power_control::startupPhaseDone("Power state initialized");
+
+    // Power Control Service.  All objects share one object server under an
+    // ObjectManager, so clients can read them all with one GetManagedObjects.
+    // Interfaces initialized after this point are announced with
+    // InterfacesAdded through the ObjectManager.
+    sdbusplus::server::manager::manager objectManager(
+        *power_control::conn, power_control::objectManagerPath);
+    sdbusplus::asio::object_server objectServer =
         sdbusplus::asio::object_server(power_control::conn);
 
     // Power Control Interface
-    power_control::hostIface = hostServer.add_interface(
-        "/xyz/openbmc_project/state/host0", "xyz.openbmc_project.State.Host");
+    power_control::hostIface = objectServer.add_interface(
+        power_control::hostPath, power_control::hostInterface);
 
     power_control::hostIface->register_property(
         "RequestedHostTransition",
@@ -2052,22 +5040,22 @@ int main(int argc, char* argv[])
         [](const std::string& requested, std::string& resp) {
             if (requested == "xyz.openbmc_project.State.Host.Transition.Off")
             {
+                addRestartCause(power_control::RestartCause::command);
                 sendPowerControlEvent(
                     power_control::Event::gracefulPowerOffRequest);
-                addRestartCause(power_control::RestartCause::command);
             }
             else if (requested ==
                      "xyz.openbmc_project.State.Host.Transition.On")
             {
-                sendPowerControlEvent(power_control::Event::powerOnRequest);
                 addRestartCause(power_control::RestartCause::command);
+                sendPowerControlEvent(power_control::Event::powerOnRequest);
             }
             else if (requested ==
                      "xyz.openbmc_project.State.Host.Transition.Reboot")
             {
+                addRestartCause(power_control::RestartCause::command);
                 sendPowerControlEvent(
                     power_control::Event::gracefulPowerCycleRequest);
-                addRestartCause(power_control::RestartCause::command);
             }
             else
             {
@@ -2080,20 +5068,20 @@ int main(int argc, char* argv[])
         });
     power_control::hostIface->register_property(
         "CurrentHostState",
-        std::string(power_control::getHostState(power_control::powerState)));
+        std::string(power_control::getHostState(power_control::powerState)),
+        power_control::rejectPropertySet<std::string>,
+        [](const std::string&) {
+            return std::string(
+                power_control::getHostState(power_control::powerState));
+        });
 
     power_control::currentHostStateMonitor();
 
     power_control::hostIface->initialize();
 
-    // Chassis Control Service
-    sdbusplus::asio::object_server chassisServer =
-        sdbusplus::asio::object_server(power_control::conn);
-
     // Chassis Control Interface
-    power_control::chassisIface =
-        chassisServer.add_interface("/xyz/openbmc_project/state/chassis0",
-                                    "xyz.openbmc_project.State.Chassis");
+    power_control::chassisIface = objectServer.add_interface(
+        power_control::chassisPath, power_control::chassisInterface);
 
     power_control::chassisIface->register_property(
         "RequestedPowerTransition",
@@ -2101,20 +5089,20 @@ int main(int argc, char* argv[])
         [](const std::string& requested, std::string& resp) {
             if (requested == "xyz.openbmc_project.State.Chassis.Transition.Off")
             {
-                sendPowerControlEvent(power_control::Event::powerOffRequest);
                 addRestartCause(power_control::RestartCause::command);
+                sendPowerControlEvent(power_control::Event::powerOffRequest);
             }
             else if (requested ==
                      "xyz.openbmc_project.State.Chassis.Transition.On")
             {
-                sendPowerControlEvent(power_control::Event::powerOnRequest);
                 addRestartCause(power_control::RestartCause::command);
+                sendPowerControlEvent(power_control::Event::powerOnRequest);
             }
             else if (requested ==
                      "xyz.openbmc_project.State.Chassis.Transition.PowerCycle")
             {
-                sendPowerControlEvent(power_control::Event::powerCycleRequest);
                 addRestartCause(power_control::RestartCause::command);
+                sendPowerControlEvent(power_control::Event::powerCycleRequest);
             }
             else if (requested ==
                      "xyz.openbmc_project.State.Chassis.Transition.Reset")
@@ -2133,18 +5121,23 @@ int main(int argc, char* argv[])
         });
     power_control::chassisIface->register_property(
         "CurrentPowerState",
-        std::string(power_control::getChassisState(power_control::powerState)));
+        std::string(power_control::getChassisState(power_control::powerState)),
+        power_control::rejectPropertySet<std::string>,
+        [](const std::string&) {
+            return std::string(
+                power_control::getChassisState(power_control::powerState));
+        });
     power_control::chassisIface->register_property(
-        "LastStateChangeTime", power_control::getCurrentTimeMs());
+        "LastStateChangeTime",
+        power_control::powerStateChangeRealtimeMs,
+        power_control::rejectPropertySet<uint64_t>, [](const uint64_t&) {
+            return power_control::powerStateChangeRealtimeMs;
+        });
 
     power_control::chassisIface->initialize();
 
-    // Buttons Service
-    sdbusplus::asio::object_server buttonsServer =
-        sdbusplus::asio::object_server(power_control::conn);
-
     // Power Button Interface
-    power_control::powerButtonIface = buttonsServer.add_interface(
+    power_control::powerButtonIface = objectServer.add_interface(
         "/xyz/openbmc_project/chassis/buttons/power",
         "xyz.openbmc_project.Chassis.Buttons");
 
@@ -2157,7 +5150,8 @@ int main(int argc, char* argv[])
                     return 1;
                 }
                 if (!power_control::setGPIOOutput(
-                        "POWER_OUT", 1, power_control::powerButtonMask))
+                        power_control::powerOutName, 0,
+                        power_control::powerButtonMask))
                 {
                     throw std::runtime_error("Failed to request GPIO");
                     return 0;
@@ -2171,6 +5165,7 @@ int main(int argc, char* argv[])
                     return 1;
                 }
                 std::cerr << "Power Button Un-masked\n";
+                power_control::powerButtonMask.release();
                 power_control::powerButtonMask.reset();
             }
             // Update the mask setting
@@ -2179,14 +5174,16 @@ int main(int argc, char* argv[])
         });
 
     // Check power button state
-    bool powerButtonPressed = power_control::powerButtonLine.get_value() == 0;
+    bool powerButtonPressed = lineValues[power_control::powerButtonName] > 0;
+    power_control::buttonsPressed[power_control::powerButtonName] =
+        powerButtonPressed;
     power_control::powerButtonIface->register_property("ButtonPressed",
                                                        powerButtonPressed);
 
     power_control::powerButtonIface->initialize();
 
     // Reset Button Interface
-    power_control::resetButtonIface = buttonsServer.add_interface(
+    power_control::resetButtonIface = objectServer.add_interface(
         "/xyz/openbmc_project/chassis/buttons/reset",
         "xyz.openbmc_project.Chassis.Buttons");
 
@@ -2199,7 +5196,8 @@ int main(int argc, char* argv[])
                     return 1;
                 }
                 if (!power_control::setGPIOOutput(
-                        "RESET_OUT", 1, power_control::resetButtonMask))
+                        power_control::resetOutName, 0,
+                        power_control::resetButtonMask))
                 {
                     throw std::runtime_error("Failed to request GPIO");
                     return 0;
@@ -2213,6 +5211,7 @@ int main(int argc, char* argv[])
                     return 1;
                 }
                 std::cerr << "Reset Button Un-masked\n";
+                power_control::resetButtonMask.release();
                 power_control::resetButtonMask.reset();
             }
             // Update the mask setting
@@ -2221,7 +5220,9 @@ int main(int argc, char* argv[])
         });
 
     // Check reset button state
-    bool resetButtonPressed = power_control::resetButtonLine.get_value() == 0;
+    bool resetButtonPressed = lineValues[power_control::resetButtonName] > 0;
+    power_control::buttonsPressed[power_control::resetButtonName] =
+        resetButtonPressed;
     power_control::resetButtonIface->register_property("ButtonPressed",
                                                        resetButtonPressed);
 
@@ -2229,8 +5230,8 @@ int main(int argc, char* argv[])
 
     // NMI Button Interface
     power_control::nmiButtonIface =
-        buttonsServer.add_interface("/xyz/openbmc_project/chassis/buttons/nmi",
-                                    "xyz.openbmc_project.Chassis.Buttons");
+        objectServer.add_interface("/xyz/openbmc_project/chassis/buttons/nmi",
+                                   "xyz.openbmc_project.Chassis.Buttons");
 
     power_control::nmiButtonIface->register_property(
         "ButtonMasked", false, [](const bool requested, bool& current) {
@@ -2255,62 +5256,55 @@ int main(int argc, char* argv[])
         });
 
     // Check NMI button state
-    bool nmiButtonPressed = power_control::nmiButtonLine.get_value() == 0;
+    bool nmiButtonPressed = lineValues[power_control::nmiButtonName] > 0;
+    power_control::buttonsPressed[power_control::nmiButtonName] =
+        nmiButtonPressed;
     power_control::nmiButtonIface->register_property("ButtonPressed",
                                                      nmiButtonPressed);
 
     power_control::nmiButtonIface->initialize();
 
-    // NMI out Service
-    sdbusplus::asio::object_server nmiOutServer =
-        sdbusplus::asio::object_server(power_control::conn);
-
     // NMI out Interface
     power_control::nmiOutIface =
-        nmiOutServer.add_interface("/xyz/openbmc_project/control/host0/nmi",
+        objectServer.add_interface("/xyz/openbmc_project/control/host0/nmi",
                                    "xyz.openbmc_project.Control.Host.NMI");
     power_control::nmiOutIface->register_method("NMI", power_control::nmiReset);
     power_control::nmiOutIface->initialize();
 
     // ID Button Interface
     power_control::idButtonIface =
-        buttonsServer.add_interface("/xyz/openbmc_project/chassis/buttons/id",
-                                    "xyz.openbmc_project.Chassis.Buttons");
+        objectServer.add_interface("/xyz/openbmc_project/chassis/buttons/id",
+                                   "xyz.openbmc_project.Chassis.Buttons");
 
     // Check ID button state
-    bool idButtonPressed = power_control::idButtonLine.get_value() == 0;
+    bool idButtonPressed = lineValues[power_control::idButtonName] > 0;
+    power_control::buttonsPressed[power_control::idButtonName] =
+        idButtonPressed;
     power_control::idButtonIface->register_property("ButtonPressed",
                                                     idButtonPressed);
 
     power_control::idButtonIface->initialize();
 
-    // OS State Service
-    sdbusplus::asio::object_server osServer =
-        sdbusplus::asio::object_server(power_control::conn);
-
     // OS State Interface
-    power_control::osIface = osServer.add_interface(
+    power_control::osIface = objectServer.add_interface(
         "/xyz/openbmc_project/state/os",
         "xyz.openbmc_project.State.OperatingSystem.Status");
 
     // Get the initial OS state based on POST complete
-    //      0: Asserted, OS state is "Standby" (ready to boot)
-    //      1: De-Asserted, OS state is "Inactive"
-    std::string osState = power_control::postCompleteLine.get_value() > 0
-                              ? "Inactive"
-                              : "Standby";
+    //      1: Asserted, OS state is "Standby" (ready to boot)
+    //      0: De-Asserted, OS state is "Inactive"
+    std::string osState = lineValues[power_control::postCompleteName] > 0
+                              ? "Standby"
+                              : "Inactive";
 
+    power_control::operatingSystemState = osState;
     power_control::osIface->register_property("OperatingSystemState",
                                               std::string(osState));
 
     power_control::osIface->initialize();
 
-    // Restart Cause Service
-    sdbusplus::asio::object_server restartCauseServer =
-        sdbusplus::asio::object_server(power_control::conn);
-
     // Restart Cause Interface
-    power_control::restartCauseIface = restartCauseServer.add_interface(
+    power_control::restartCauseIface = objectServer.add_interface(
         "/xyz/openbmc_project/control/host0/restart_cause",
         "xyz.openbmc_project.Control.Host.RestartCause");
 
@@ -2342,7 +5336,173 @@ int main(int argc, char* argv[])
 
     power_control::restartCauseIface->initialize();
 
+    // Metrics Interface
+    power_control::metricsIface = objectServer.add_interface(
+        power_control::powerControlPath,
+        "xyz.openbmc_project.Control.Power.Metrics");
+
+    power_control::registerMetric(
+        "LastDispatchLatencyUs",
+        power_control::dispatchMetrics.lastLatencyUs);
+    power_control::registerMetric("MaxDispatchLatencyUs",
+                                  power_control::dispatchMetrics.maxLatencyUs);
+    power_control::registerMetric(
+        "LastDispatchDurationUs",
+        power_control::dispatchMetrics.lastDurationUs);
+    power_control::registerMetric(
+        "MaxDispatchDurationUs", power_control::dispatchMetrics.maxDurationUs);
+    power_control::registerMetric(
+        "LastRequestLatencyUs",
+        power_control::dispatchMetrics.lastRequestLatencyUs);
+    power_control::registerMetric("PropertiesChangedSignals",
+                                  power_control::propertiesChangedSignals);
+    power_control::registerMetric("LastEventPropertiesChangedSignals",
+                                  power_control::lastBatchSignals);
+    power_control::registerMetric("StartupReadyMs",
+                                  power_control::startupReadyMs);
+    power_control::registerMetric("OutstandingCalls",
+                                  power_control::callMetrics.outstanding);
+    power_control::registerMetric("MaxOutstandingCalls",
+                                  power_control::callMetrics.maxOutstanding);
+    power_control::registerMetric("FailedCalls",
+                                  power_control::callMetrics.failed);
+    power_control::registerMetric("TimedOutCalls",
+                                  power_control::callMetrics.timedOut);
+    power_control::registerMetric("RetriedCalls",
+                                  power_control::callMetrics.retried);
+    power_control::registerMetric("RejectedCalls",
+                                  power_control::callMetrics.rejected);
+    power_control::registerMetric("FlashWrites",
+                                  power_control::flashMetrics.writes);
+    power_control::registerMetric("FlashBytesWritten",
+                                  power_control::flashMetrics.bytesWritten);
+    power_control::registerMetric(
+        "SkippedPowerStateWrites",
+        power_control::flashMetrics.skippedPowerStateWrites);
+    power_control::registerMetric("JournalRecords",
+                                  power_control::flashMetrics.journalRecords);
+    power_control::registerMetric("DroppedLogMessages",
+                                  power_control::droppedLogMessages);
+    power_control::registerMetric("TruncatedLogMessages",
+                                  power_control::truncatedLogMessages);
+    power_control::registerMetric(
+        "RestoreDelayFirmwareMs",
+        power_control::restoreDelayBudget.firmwareMs);
+    power_control::registerMetric(
+        "RestoreDelayBootTimeMs",
+        power_control::restoreDelayBudget.bootTimeMs);
+    power_control::registerMetric("RestoreDelayTimerMs",
+                                  power_control::restoreDelayBudget.timerMs);
+    power_control::registerMetric("RestoreJitterMs",
+                                  power_control::restoreJitterMs);
+    power_control::registerMetric("PowerTokenWaitMs",
+                                  power_control::powerTokenWaitMs);
+    power_control::registerMetric("ACRestoreLatencyMs",
+                                  power_control::acRestoreLatencyMs);
+    power_control::registerMetric("ACRestoreFromMirror",
+                                  power_control::acRestoreFromMirror);
+    power_control::metricsIface->register_property(
+        "MatchesDelivered", power_control::MatchCounts(),
+        power_control::rejectPropertySet<power_control::MatchCounts>,
+        [](const power_control::MatchCounts&) {
+            return power_control::getMatchCounts(
+                [](const power_control::MatchCounters& counters) {
+                    return counters.delivered;
+                });
+        });
+    power_control::metricsIface->register_property(
+        "MatchesActedOn", power_control::MatchCounts(),
+        power_control::rejectPropertySet<power_control::MatchCounts>,
+        [](const power_control::MatchCounts&) {
+            return power_control::getMatchCounts(
+                [](const power_control::MatchCounters& counters) {
+                    return counters.actedOn;
+                });
+        });
+
+    power_control::metricsIface->initialize();
+
+    // Edge Storm Interface
+    power_control::edgeStormIface = objectServer.add_interface(
+        power_control::powerControlPath,
+        "xyz.openbmc_project.Control.Power.EdgeStorm");
+
+    power_control::edgeStormIface->register_property(
+        "SuppressedEdges", power_control::EdgeCounts(),
+        power_control::rejectPropertySet<power_control::EdgeCounts>,
+        [](const power_control::EdgeCounts&) {
+            return power_control::getEdgeCounts(
+                [](const power_control::GPIOEventMonitor& monitor) {
+                    return monitor.suppressedEdges;
+                });
+        });
+    power_control::edgeStormIface->register_property(
+        "EdgeStorms", power_control::EdgeCounts(),
+        power_control::rejectPropertySet<power_control::EdgeCounts>,
+        [](const power_control::EdgeCounts&) {
+            return power_control::getEdgeCounts(
+                [](const power_control::GPIOEventMonitor& monitor) {
+                    return monitor.edgeStorms;
+                });
+        });
+
+    power_control::edgeStormIface->initialize();
+
+    // Logging Interface
+    power_control::loggingIface = objectServer.add_interface(
+        power_control::powerControlPath,
+        "xyz.openbmc_project.Control.Power.Logging");
+
+    for (size_t subsystem = 0;
+         subsystem < power_control::logSubsystemNames.size(); subsystem++)
+    {
+        power_control::registerLogLevel(subsystem);
+    }
+
+    power_control::loggingIface->initialize();
+
+    // Power Status Interface
+    power_control::statusIface = objectServer.add_interface(
+        power_control::powerControlPath,
+        "xyz.openbmc_project.Control.Power.Status");
+
+    power_control::statusIface->register_method(
+        "GetPowerStatus", power_control::getPowerStatus);
+
+    power_control::statusIface->initialize();
+
+    // Power Transition Interface
+    power_control::transitionIface = objectServer.add_interface(
+        power_control::powerControlPath,
+        "xyz.openbmc_project.Control.Power.Transition");
+
+    power_control::addPowerStateObserver(
+        power_control::transitionWaitersObserver);
+    power_control::transitionIface->register_method(
+        "PowerOn", power_control::powerOnMethod);
+    power_control::transitionIface->register_method(
+        "PowerOff", power_control::powerOffMethod);
+    power_control::transitionIface->register_method(
+        "PowerCycle", power_control::powerCycleMethod);
+    power_control::transitionIface->register_method(
+        "Reset", power_control::resetMethod);
+
+    power_control::transitionIface->initialize();
+
+    power_control::startupRequestDone("D-Bus interfaces registered");
+
+    // Checkpoint the power-on hours before stopping
+    boost::asio::signal_set signals(power_control::io, SIGINT, SIGTERM);
+    signals.async_wait([](const boost::system::error_code ec, int) {
+        if (ec)
+        {
+            return;
+        }
+        power_control::pohSave(std::chrono::steady_clock::now());
+        power_control::io.stop();
+    });
+
     power_control::io.run();
 
-    return 0;
+    return power_control::fatalError ? -1 : 0;
 }
@@ -0,0 +1,136 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+#include "power_event_journal.hpp"
+
+#include <time.h>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Decodes the power event journal written by power-control.  With no
+// arguments it prints the rotated journal followed by the current one.
+
+static const std::filesystem::path powerControlDir = "/var/lib/power-control";
+
+static std::string formatRealtime(const uint64_t realtimeMs)
+{
+    time_t seconds = realtimeMs / 1000;
+    struct tm tm = {};
+    gmtime_r(&seconds, &tm);
+    std::array<char, 32> buffer;
+    strftime(buffer.data(), buffer.size(), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::array<char, 8> millis;
+    snprintf(millis.data(), millis.size(), ".%03uZ",
+             static_cast<unsigned>(realtimeMs % 1000));
+    return std::string(buffer.data()) + millis.data();
+}
+
+static void printRecord(const power_event_journal::Record& record)
+{
+    using namespace power_event_journal;
+    std::cout << formatRealtime(record.realtimeMs) << " mono="
+              << record.monotonicUs / 1000000 << "." << std::setfill('0')
+              << std::setw(6) << record.monotonicUs % 1000000
+              << std::setfill(' ') << " "
+              << getName(recordTypeNames, static_cast<size_t>(record.type));
+    switch (record.type)
+    {
+        case RecordType::start:
+            std::cout << " in " << getName(powerStateNames, record.toState);
+            break;
+        case RecordType::transition:
+            std::cout << " " << getName(powerStateNames, record.fromState)
+                      << " -> " << getName(powerStateNames, record.toState)
+                      << " on " << getName(eventNames, record.code);
+            break;
+        case RecordType::restartCause:
+            std::cout << " " << getName(restartCauseNames, record.code)
+                      << " from";
+            for (size_t cause = 0; cause < restartCauseNames.size(); cause++)
+            {
+                if (record.data & (1U << cause))
+                {
+                    std::cout << " " << restartCauseNames[cause];
+                }
+            }
+            break;
+        case RecordType::psPowerOKFailed:
+        case RecordType::systemPowerGoodFailed:
+            std::cout << " in " << getName(powerStateNames, record.toState);
+            break;
+        default:
+            break;
+    }
+    std::cout << "\n";
+}
+
+static bool printJournal(const std::filesystem::path& path)
+{
+    std::ifstream journal(path, std::ios::binary);
+    if (!journal.is_open())
+    {
+        std::cerr << "Unable to open " << path << "\n";
+        return false;
+    }
+    std::cout << "# " << path.string() << "\n";
+    size_t offset = 0;
+    power_event_journal::Record record;
+    while (journal.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        if (record.magic != power_event_journal::recordMagic ||
+            record.crc != power_event_journal::getRecordCRC(record))
+        {
+            std::cout << "corrupt record at offset " << offset << "\n";
+        }
+        else
+        {
+            printRecord(record);
+        }
+        offset += sizeof(record);
+    }
+    if (journal.gcount() != 0)
+    {
+        std::cout << "torn record at offset " << offset << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1)
+    {
+        bool ok = true;
+        for (int arg = 1; arg < argc; arg++)
+        {
+            ok = printJournal(argv[arg]) && ok;
+        }
+        return ok ? 0 : -1;
+    }
+
+    std::filesystem::path rotated =
+        powerControlDir / power_event_journal::rotatedJournalFile;
+    if (std::filesystem::exists(rotated))
+    {
+        printJournal(rotated);
+    }
+    return printJournal(powerControlDir / power_event_journal::journalFile)
+               ? 0
+               : -1;
+}
@@ -0,0 +1,385 @@
+#!/usr/bin/env python3
+"""Drive power-control against simulated GPIO lines.
+
+The GPIO lines come from a gpio-sim chip with the default line names, and
+a scripted model plays the power supply and the SIO: it follows POWER_OUT
+and RESET_OUT and drives PS_PWROK, SIO_POWER_GOOD, SIO_S5 and
+POST_COMPLETE the way a host does.  The daemon runs on a private
+dbus-daemon, in a mount namespace with its state directories on tmpfs, so
+the test doesn't touch the system it runs on.
+
+After the functional checks, the daemon is power cycled a number of times
+and the transition and dispatch latencies are reported.
+
+Needs root, configfs and the gpio-sim module.  Exits with 77 (skipped)
+when they are not available.
+
+Usage: power_control_sim_test.py <power-control binary> [cycles]
+"""
+
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+SKIP = 77
+
+GPIO_SIM_CONFIG = "/sys/kernel/config/gpio-sim"
+CHIP = "power-control-sim"
+
+# Line name and whether it is active low, as in the default power config
+LINES = [
+    ("PS_PWROK", False),
+    ("SIO_POWER_GOOD", False),
+    ("SIO_ONCONTROL", False),
+    ("SIO_S5", True),
+    ("POWER_BUTTON", True),
+    ("RESET_BUTTON", True),
+    ("NMI_BUTTON", True),
+    ("ID_BUTTON", True),
+    ("POST_COMPLETE", True),
+    ("POWER_OUT", True),
+    ("RESET_OUT", True),
+    ("NMI_OUT", False),
+]
+OUTPUTS = {"POWER_OUT", "RESET_OUT", "NMI_OUT"}
+
+SERVICE = "xyz.openbmc_project.State.Chassis"
+CHASSIS_PATH = "/xyz/openbmc_project/state/chassis0"
+CHASSIS_INTERFACE = "xyz.openbmc_project.State.Chassis"
+CONTROL_PATH = "/xyz/openbmc_project/control/host0/power_control"
+METRICS_INTERFACE = "xyz.openbmc_project.Control.Power.Metrics"
+POWER_STATE = "xyz.openbmc_project.State.Chassis.PowerState."
+POWER_TRANSITION = "xyz.openbmc_project.State.Chassis.Transition."
+TRANSITION_INTERFACE = "xyz.openbmc_project.Control.Power.Transition"
+
+BUS_CONFIG = """<!DOCTYPE busconfig PUBLIC
+ "-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN"
+ "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+<busconfig>
+  <type>system</type>
+  <listen>unix:path={socket}</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow user="*"/>
+    <allow own="*"/>
+    <allow send_destination="*" eavesdrop="true"/>
+    <allow eavesdrop="true"/>
+  </policy>
+</busconfig>
+"""
+
+
+class SimChip:
+    """A gpio-sim chip with one bank holding LINES."""
+
+    def __init__(self):
+        self.config = os.path.join(GPIO_SIM_CONFIG, CHIP)
+        self.bank = os.path.join(self.config, "bank0")
+        os.mkdir(self.config)
+        os.mkdir(self.bank)
+        self._write(os.path.join(self.bank, "num_lines"), len(LINES))
+        for offset, (name, _) in enumerate(LINES):
+            line = os.path.join(self.bank, "line%d" % offset)
+            os.mkdir(line)
+            self._write(os.path.join(line, "name"), name)
+        self._write(os.path.join(self.config, "live"), 1)
+        device = self._read(os.path.join(self.config, "dev_name"))
+        chip = self._read(os.path.join(self.bank, "chip_name"))
+        self.sysfs = "/sys/devices/platform/%s/%s" % (device, chip)
+        self.offsets = {name: i for i, (name, _) in enumerate(LINES)}
+        self.active_low = dict(LINES)
+
+    @staticmethod
+    def _write(path, value):
+        with open(path, "w") as f:
+            f.write(str(value))
+
+    @staticmethod
+    def _read(path):
+        with open(path) as f:
+            return f.read().strip()
+
+    def _attribute(self, name, attribute):
+        return os.path.join(
+            self.sysfs, "sim_gpio%d" % self.offsets[name], attribute
+        )
+
+    def set(self, name, asserted):
+        """Drives an input line to its asserted or deasserted level."""
+        high = asserted != self.active_low[name]
+        self._write(
+            self._attribute(name, "pull"), "pull-up" if high else "pull-down"
+        )
+
+    def asserted(self, name):
+        """Reads whether a line, usually an output, is asserted."""
+        high = self._read(self._attribute(name, "value")) == "1"
+        return high != self.active_low[name]
+
+    def remove(self):
+        self._write(os.path.join(self.config, "live"), 0)
+        for offset in range(len(LINES)):
+            os.rmdir(os.path.join(self.bank, "line%d" % offset))
+        os.rmdir(self.bank)
+        os.rmdir(self.config)
+
+
+class HostModel(threading.Thread):
+    """Plays the power supply, the SIO and the host firmware.
+
+    A POWER_OUT press powers an off host on.  Holding it for
+    FORCE_OFF_S forces the host off, and a shorter press shuts a running
+    host down.  A RESET_OUT pulse drops POST_COMPLETE until the host has
+    been through POST again.
+    """
+
+    POLL_S = 0.002
+    PS_POWER_OK_S = 0.05
+    SIO_POWER_GOOD_S = 0.05
+    POST_S = 0.1
+    SHUTDOWN_S = 0.2
+    FORCE_OFF_S = 4.0
+
+    def __init__(self, chip):
+        super().__init__(daemon=True)
+        self.chip = chip
+        self.stopping = threading.Event()
+        self.on = False
+        self.power_off()
+        for name, _ in LINES:
+            if name in OUTPUTS:
+                # Deasserted until the daemon requests its outputs
+                self.chip.set(name, False)
+        for button in ("POWER_BUTTON", "RESET_BUTTON", "NMI_BUTTON",
+                       "ID_BUTTON", "SIO_ONCONTROL"):
+            self.chip.set(button, False)
+
+    def power_on(self):
+        time.sleep(self.PS_POWER_OK_S)
+        self.chip.set("PS_PWROK", True)
+        time.sleep(self.SIO_POWER_GOOD_S)
+        self.chip.set("SIO_S5", False)
+        self.chip.set("SIO_POWER_GOOD", True)
+        self.on = True
+        time.sleep(self.POST_S)
+        self.chip.set("POST_COMPLETE", True)
+
+    def power_off(self):
+        self.chip.set("POST_COMPLETE", False)
+        self.chip.set("SIO_POWER_GOOD", False)
+        self.chip.set("SIO_S5", True)
+        self.chip.set("PS_PWROK", False)
+        self.on = False
+
+    def reset(self):
+        self.chip.set("POST_COMPLETE", False)
+        while self.chip.asserted("RESET_OUT"):
+            time.sleep(self.POLL_S)
+        time.sleep(self.POST_S)
+        self.chip.set("POST_COMPLETE", True)
+
+    def run(self):
+        press_start = None
+        forced_off = False
+        while not self.stopping.wait(self.POLL_S):
+            if self.on and self.chip.asserted("RESET_OUT"):
+                self.reset()
+            pressed = self.chip.asserted("POWER_OUT")
+            if pressed and press_start is None:
+                press_start = time.monotonic()
+            elif pressed and self.on:
+                if time.monotonic() - press_start >= self.FORCE_OFF_S:
+                    self.power_off()
+                    forced_off = True
+            elif not pressed and press_start is not None:
+                press_start = None
+                if forced_off:
+                    # The press is over once it has forced the host off
+                    forced_off = False
+                elif not self.on:
+                    self.power_on()
+                else:
+                    time.sleep(self.SHUTDOWN_S)
+                    self.power_off()
+
+    def stop(self):
+        self.stopping.set()
+        self.join()
+
+
+class Bus:
+    """A private dbus-daemon standing in for the system bus."""
+
+    def __init__(self, directory):
+        socket = os.path.join(directory, "system_bus_socket")
+        config = os.path.join(directory, "bus.conf")
+        with open(config, "w") as f:
+            f.write(BUS_CONFIG.format(socket=socket))
+        self.process = subprocess.Popen(
+            ["dbus-daemon", "--config-file=" + config, "--nofork",
+             "--print-address"],
+            stdout=subprocess.PIPE, universal_newlines=True)
+        self.address = self.process.stdout.readline().strip()
+
+    def busctl(self, *args):
+        output = subprocess.check_output(
+            ["busctl", "--address=" + self.address, "--json=short"]
+            + list(args), universal_newlines=True, timeout=120)
+        return json.loads(output)["data"] if output.strip() else None
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+
+
+class Daemon:
+    """power-control with its state directories on tmpfs."""
+
+    STATE_DIRECTORIES = ("/var/lib/power-control", "/run/power-control")
+
+    def __init__(self, binary, bus):
+        for directory in self.STATE_DIRECTORIES:
+            os.makedirs(directory, exist_ok=True)
+        mounts = " && ".join(
+            "mount -t tmpfs tmpfs " + d for d in self.STATE_DIRECTORIES)
+        env = dict(os.environ, DBUS_SYSTEM_BUS_ADDRESS=bus.address)
+        self.process = subprocess.Popen(
+            ["unshare", "--mount", "--propagation", "private", "sh", "-c",
+             mounts + ' && exec "$0"', binary], env=env)
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+
+
+def get_power_state(bus):
+    state = bus.busctl("get-property", SERVICE, CHASSIS_PATH,
+                       CHASSIS_INTERFACE, "CurrentPowerState")
+    return state[len(POWER_STATE):]
+
+
+def get_metric(bus, name):
+    return bus.busctl("get-property", SERVICE, CONTROL_PATH,
+                      METRICS_INTERFACE, name)
+
+
+def request_power(bus, state, timeout_s=30):
+    """Requests a chassis power transition and waits for the power state.
+
+    Returns the time, in ms, from the request to the new power state, or
+    None if the state wasn't reached in time.
+    """
+    start = time.monotonic()
+    bus.busctl("set-property", SERVICE, CHASSIS_PATH, CHASSIS_INTERFACE,
+               "RequestedPowerTransition", "s", POWER_TRANSITION + state)
+    while time.monotonic() - start < timeout_s:
+        if get_power_state(bus) == state:
+            return int((time.monotonic() - start) * 1000)
+        time.sleep(0.01)
+    return None
+
+
+def transition(bus, method, timeout_ms=30000):
+    """Calls a blocking transition method, returning its outcome."""
+    outcome, _ = bus.busctl("call", SERVICE, CONTROL_PATH,
+                            TRANSITION_INTERFACE, method, "u",
+                            str(timeout_ms))
+    return outcome
+
+
+def wait_for_daemon(bus, daemon):
+    deadline = time.monotonic() + 10
+    while time.monotonic() < deadline:
+        if daemon.process.poll() is not None:
+            raise RuntimeError("power-control exited during startup")
+        try:
+            return get_power_state(bus)
+        except subprocess.CalledProcessError:
+            time.sleep(0.1)
+    raise RuntimeError("power-control did not start")
+
+
+def check(condition, message):
+    if not condition:
+        raise AssertionError(message)
+    print("ok: " + message)
+
+
+def check_transitions(bus, daemon):
+    check(wait_for_daemon(bus, daemon) == "Off", "host starts off")
+    check(request_power(bus, "On") is not None, "On powers the host on")
+    check(request_power(bus, "On") is not None,
+          "On leaves a running host on")
+    check(transition(bus, "Reset") == "Success" and
+          get_power_state(bus) == "On",
+          "Reset completes once the host is back through POST")
+    check(request_power(bus, "Off") is not None, "Off powers the host off")
+
+
+def summarize(name, values):
+    print("%-28s min %8d  median %8d  max %8d" %
+          (name, min(values), statistics.median(values), max(values)))
+
+
+def benchmark(bus, cycles):
+    power_on_ms = []
+    request_latency_us = []
+    for _ in range(cycles):
+        elapsed_ms = request_power(bus, "On")
+        check(elapsed_ms is not None, "On in benchmark")
+        power_on_ms.append(elapsed_ms)
+        request_latency_us.append(get_metric(bus, "LastRequestLatencyUs"))
+        check(request_power(bus, "Off") is not None, "Off in benchmark")
+    print("%d power cycles:" % cycles)
+    summarize("Power on elapsed (ms)", power_on_ms)
+    summarize("LastRequestLatencyUs", request_latency_us)
+    print("%-28s %8d" % ("MaxDispatchLatencyUs",
+                         get_metric(bus, "MaxDispatchLatencyUs")))
+    print("%-28s %8d" % ("MaxDispatchDurationUs",
+                         get_metric(bus, "MaxDispatchDurationUs")))
+
+
+def missing_requirements():
+    if os.geteuid() != 0:
+        return "needs root"
+    if not os.path.isdir(GPIO_SIM_CONFIG) and shutil.which("modprobe"):
+        subprocess.call(["modprobe", "gpio-sim"], stderr=subprocess.DEVNULL)
+    if not os.path.isdir(GPIO_SIM_CONFIG):
+        return "gpio-sim is not available"
+    for tool in ("dbus-daemon", "busctl", "unshare"):
+        if shutil.which(tool) is None:
+            return tool + " is not installed"
+    return None
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    binary = os.path.abspath(sys.argv[1])
+    cycles = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+    reason = missing_requirements()
+    if reason:
+        print("skipped: " + reason)
+        sys.exit(SKIP)
+
+    chip = SimChip()
+    model = HostModel(chip)
+    model.start()
+    directory = tempfile.mkdtemp()
+    bus = Bus(directory)
+    daemon = Daemon(binary, bus)
+    try:
+        check_transitions(bus, daemon)
+        benchmark(bus, cycles)
+    finally:
+        daemon.stop()
+        bus.stop()
+        model.stop()
+        chip.remove()
+        shutil.rmtree(directory)